@@ -0,0 +1,42 @@
+#version 460
+
+in vec3 vertex_pos;
+in vec2 texture_coord;
+in vec3 vertex_normal;
+in vec3 view_pos;
+flat in int texture_layer;
+flat in int normal_map_layer;
+
+out vec4 color;
+
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
+
+// Texture arrays holding the textures of every object of the multi draw, the layers come from the vertex shader
+uniform sampler2DArray texture_data;
+uniform sampler2DArray normal_map_data;
+
+void main(void)
+{
+	vec4 texture_color = texture(texture_data, vec3(texture_coord, texture_layer));
+
+	const float ambient_coefficient = 0.8;
+	const float diffuse_coefficient = 0.3;
+	const float specular_coefficient = 0.3;
+
+	vec3 light_direction = normalize(frame.light_position.xyz - vertex_pos);
+	vec3 view_direction = normalize(view_pos - vertex_pos);
+	vec3 reflect_direction = reflect(-light_direction, vertex_normal);
+
+	float specular_intensity = specular_coefficient * pow(max(dot(view_direction, reflect_direction), 0.0), 32);
+	float normal_intensity = diffuse_coefficient * max(dot(vertex_normal, light_direction), 0.0);
+
+	vec3 rgb_color = (ambient_coefficient + normal_intensity + specular_intensity) * frame.light_color.rgb * texture_color.rgb;
+	color = vec4(rgb_color, texture_color.a);
+}
@@ -0,0 +1,47 @@
+#version 460
+
+in vec3 position;
+in vec2 texture;
+in vec3 normal;
+
+out vec3 vertex_pos;
+out vec2 texture_coord;
+out vec3 vertex_normal;
+out vec3 view_pos;
+flat out int texture_layer;
+flat out int normal_map_layer;
+
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
+
+// Model matrix and texture layers of every draw of a multi draw, see renderQueue.hpp
+// Meshes drawn this way live in a mesh arena, which never holds quantized vertices
+struct Draw
+{
+	mat4 model;
+	int texture_layer;
+	int normal_map_layer;
+};
+
+layout(std430, binding = 2) readonly buffer DrawData
+{
+	Draw draws[];
+};
+
+void main(void)
+{
+	mat4 model = draws[gl_DrawID].model;
+	gl_Position = frame.projection * frame.view * model * vec4(position, 1.0);
+	texture_coord = texture;
+	vertex_normal = normalize(vec3(model * vec4(normal, 0.0)));
+	vertex_pos = vec3(model * vec4(position, 1.0));
+	view_pos = vec3(-frame.view[3]);
+	texture_layer = draws[gl_DrawID].texture_layer;
+	normal_map_layer = draws[gl_DrawID].normal_map_layer;
+}
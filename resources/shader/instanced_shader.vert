@@ -0,0 +1,51 @@
+#version 430
+
+in vec3 position;
+in vec2 texture;
+in vec3 normal;
+
+out vec3 vertex_pos;
+out vec2 texture_coord;
+out vec3 vertex_normal;
+out vec3 view_pos;
+
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
+
+// Model matrix of every instance, see instances.hpp
+layout(std430, binding = 1) readonly buffer Instances
+{
+	mat4 instance_models[];
+};
+
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+uniform bool octahedral_normals;
+
+vec3 decodeNormal(vec3 packed_normal)
+{
+	if(!octahedral_normals)
+		return packed_normal;
+	vec3 n = vec3(packed_normal.xy, 1.0 - abs(packed_normal.x) - abs(packed_normal.y));
+	float t = max(-n.z, 0.0);
+	n.x += (n.x >= 0.0) ? -t : t;
+	n.y += (n.y >= 0.0) ? -t : t;
+	return normalize(n);
+}
+
+void main(void)
+{
+	mat4 model = instance_models[gl_InstanceID];
+	vec3 vertex_position = position_offset + position * position_scale;
+	gl_Position = frame.projection * frame.view * model * vec4(vertex_position, 1.0);
+	texture_coord = texture;
+	vertex_normal = normalize(vec3(model * vec4(decodeNormal(normal), 0.0)));
+	vertex_pos = vec3(model * vec4(vertex_position, 1.0));
+	view_pos = vec3(-frame.view[3]);
+}
@@ -7,13 +7,24 @@ in vec3 normal;
 out vec4 vertex_color;
 out vec2 texture_coord;
 
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+uniform vec3 position_offset;
+uniform vec3 position_scale;
 
 void main(void)
 {
-	gl_Position = projection * view * model * vec4(position.x, position.y, position.z, 1.0);
+	vec3 vertex_position = position_offset + position * position_scale;
+	gl_Position = frame.projection * frame.view * model * vec4(vertex_position, 1.0);
 	texture_coord = texture;
 	vertex_color = vec4(gl_Position.x, gl_Position.y, gl_Position.x * gl_Position.y, 1.0);
 }
@@ -8,15 +8,24 @@ in mat4 model_mat;
 
 out vec4 color;
 
-uniform vec3 light_pos;
-uniform vec3 light_color;
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
 
-uniform sampler2D texture_data;
-uniform sampler2D normal_map_data;
+// Layers of the texture arrays holding this object's textures
+uniform sampler2DArray texture_data;
+uniform sampler2DArray normal_map_data;
+uniform int texture_layer;
+uniform int normal_map_layer;
 
 void main(void)
 {
-	vec4 texture_color = texture(texture_data, texture_coord);
+	vec4 texture_color = texture(texture_data, vec3(texture_coord, texture_layer));
 	float intensity = length(texture_color.rgb);
 	color = vec4(0.6 * pow(intensity, 3) * texture_color.rgb, texture_color.a);
 }
@@ -8,27 +8,36 @@ in mat4 model_mat;
 
 out vec4 color;
 
-uniform vec3 light_pos;
-uniform vec3 light_color;
-
-uniform sampler2D texture_data;
-uniform sampler2D normal_map_data;
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
+
+// Layers of the texture arrays holding this object's textures
+uniform sampler2DArray texture_data;
+uniform sampler2DArray normal_map_data;
+uniform int texture_layer;
+uniform int normal_map_layer;
 
 void main(void)
 {
-	vec4 texture_color = texture(texture_data, texture_coord);
+	vec4 texture_color = texture(texture_data, vec3(texture_coord, texture_layer));
 
 	const float ambient_coefficient = 0.8;
 	const float diffuse_coefficient = 0.3;
 	const float specular_coefficient = 0.3;
 
-	vec3 light_direction = normalize(light_pos - vertex_pos);
+	vec3 light_direction = normalize(frame.light_position.xyz - vertex_pos);
 	vec3 view_direction = normalize(view_pos - vertex_pos);
 	vec3 reflect_direction = reflect(-light_direction, vertex_normal);
 
 	float specular_intensity = specular_coefficient * pow(max(dot(view_direction, reflect_direction), 0.0), 32);
 	float normal_intensity = diffuse_coefficient * max(dot(vertex_normal, light_direction), 0.0);
 
-	vec3 rgb_color = (ambient_coefficient + normal_intensity + specular_intensity) * light_color * texture_color.rgb;
+	vec3 rgb_color = (ambient_coefficient + normal_intensity + specular_intensity) * frame.light_color.rgb * texture_color.rgb;
 	color = vec4(rgb_color, texture_color.a);
 }
@@ -0,0 +1,69 @@
+#version 410
+
+in vec3 vertex_pos;
+in vec2 texture_coord;
+in vec3 vertex_normal;
+in vec3 view_pos;
+in mat4 model_mat;
+
+out vec4 color;
+
+// Camera and light of the frame, written once per frame and shared by every program (std140)
+layout(std140) uniform FrameData
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+	vec4 light_color;
+} frame;
+
+// Atlas of resident tiles, each with a border, and a page table with the atlas slot (red, green) and
+// level (blue) of the finest resident tile covering every tile of every level
+uniform sampler2D texture_data;
+uniform sampler2D page_table;
+
+uniform vec2 virtual_size;
+uniform float tile_size;
+uniform float tile_border;
+uniform float atlas_size;
+uniform int max_level;
+
+vec4 virtualTexture(vec2 coord)
+{
+	vec2 texel = clamp(coord * virtual_size, vec2(0.0), virtual_size - 0.5);
+
+	// Mip level the hardware would pick, from the texel footprint of the pixel
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+	int level = clamp(int(floor(lod)), 0, max_level);
+
+	ivec2 tiles = max(textureSize(page_table, level) - 1, ivec2(0));
+	ivec2 tile = min(ivec2(texel / (tile_size * exp2(float(level)))), tiles);
+	vec3 entry = texelFetch(page_table, tile, level).rgb * 255.0 + 0.5;
+
+	// The entry may come from a coarser resident tile
+	float span = tile_size * exp2(floor(entry.b));
+	vec2 in_tile = texel / span - floor(texel / span);
+	vec2 atlas_coord = floor(entry.rg) * (tile_size + 2.0 * tile_border) + tile_border + in_tile * tile_size;
+	return textureLod(texture_data, atlas_coord / atlas_size, 0.0);
+}
+
+void main(void)
+{
+	vec4 texture_color = virtualTexture(texture_coord);
+
+	const float ambient_coefficient = 0.8;
+	const float diffuse_coefficient = 0.3;
+	const float specular_coefficient = 0.3;
+
+	vec3 light_direction = normalize(frame.light_position.xyz - vertex_pos);
+	vec3 view_direction = normalize(view_pos - vertex_pos);
+	vec3 reflect_direction = reflect(-light_direction, vertex_normal);
+
+	float specular_intensity = specular_coefficient * pow(max(dot(view_direction, reflect_direction), 0.0), 32);
+	float normal_intensity = diffuse_coefficient * max(dot(vertex_normal, light_direction), 0.0);
+
+	vec3 rgb_color = (ambient_coefficient + normal_intensity + specular_intensity) * frame.light_color.rgb * texture_color.rgb;
+	color = vec4(rgb_color, texture_color.a);
+}
@@ -0,0 +1,160 @@
+#include "assetLoader.hpp"
+#include "meshCache.hpp"
+#include "texture.hpp"
+
+#include <fstream>
+#include <string.h>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+
+#include "stb_image.h"
+
+namespace {
+	std::string readShaderFile(std::string shader_file_path, std::string kind) {
+		std::ifstream shader_fstream(shader_file_path);
+		std::string shader_string((std::istreambuf_iterator<char>(shader_fstream)), (std::istreambuf_iterator<char>()));
+		if(shader_string.empty())
+			throw std::runtime_error(std::string("Invalid ")+kind+std::string(" shader file: ")+shader_file_path);
+		return shader_string;
+	}
+}
+
+AssetLoader::AssetLoader(ThreadPool& pool, size_t upload_ring_size, unsigned int upload_slots) : pool(pool) {
+	start = std::chrono::high_resolution_clock::now();
+	if(upload_ring_size > 0)
+		ring.reset(new UploadRing(upload_ring_size, upload_slots));
+
+	// Global to stb_image, set before any worker decodes
+	stbi_set_flip_vertically_on_load(true);
+}
+
+void AssetLoader::add(std::string name, std::future<void> work, std::function<void()> upload) {
+	Load load;
+	load.name = name;
+	load.work = std::move(work);
+	load.upload = [upload](Load&) { upload(); return true; };
+	loads.push_back(std::move(load));
+}
+
+namespace {
+	std::future<void> readyFuture() {
+		std::promise<void> promise;
+		promise.set_value();
+		return promise.get_future();
+	}
+}
+
+bool AssetLoader::streamTexture(Load& load, TextureStream& stream) {
+	// Decoded, or the copy of the previous piece is done
+	if(stream.pieces.empty()) {
+		stream.pieces = texturePieces(*stream.image, ring->slotSize());
+		stream.texture->allocate(*stream.image);
+	}
+	if(stream.slot >= 0) {
+		const TexturePiece& piece = stream.pieces[stream.next_piece];
+		ring->bind();
+		stream.texture->uploadPiece(*stream.image, piece, ring->offset(stream.slot));
+		ring->unbind();
+		ring->release(stream.slot);
+		streamed_bytes += piece.size;
+		stream.slot = -1;
+		stream.next_piece++;
+	}
+	if(stream.next_piece == stream.pieces.size()) {
+		stream.texture->finish(*stream.image);
+		return true;
+	}
+
+	// Every slot still read by the GPU, try again next frame
+	stream.slot = ring->acquire();
+	if(stream.slot < 0) {
+		load.work = readyFuture();
+		return false;
+	}
+	unsigned char* destination = ring->data(stream.slot);
+	const TexturePiece& piece = stream.pieces[stream.next_piece];
+	load.work = pool.enqueue([destination, piece]() { memcpy(destination, piece.source, piece.size); });
+	return false;
+}
+
+void AssetLoader::loadMesh(std::string obj_file_path, std::shared_ptr<Mesh> mesh, const MeshSettings& settings) {
+	std::shared_ptr<MeshData> mesh_data = std::make_shared<MeshData>();
+	add(obj_file_path,
+		pool.enqueue([obj_file_path, mesh_data, settings]() { bmesh::read(obj_file_path, *mesh_data, settings); }),
+		[mesh, mesh_data, settings]() { mesh->upload(*mesh_data, settings.quantize, settings.arena); });
+}
+
+void AssetLoader::loadShader(std::string vertex_file_path, std::string fragment_file_path, std::function<void(const std::string&, const std::string&)> compile) {
+	std::shared_ptr<std::string> vertex_string = std::make_shared<std::string>();
+	std::shared_ptr<std::string> fragment_string = std::make_shared<std::string>();
+	add(vertex_file_path,
+		pool.enqueue([vertex_file_path, fragment_file_path, vertex_string, fragment_string]() {
+			*vertex_string = readShaderFile(vertex_file_path, "vertex");
+			*fragment_string = readShaderFile(fragment_file_path, "fragment");
+		}),
+		[compile, vertex_string, fragment_string]() { compile(*vertex_string, *fragment_string); });
+}
+
+void AssetLoader::loadTexture(std::string image_file_path, std::shared_ptr<Texture> texture, const TextureSettings& settings) {
+	std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+	std::future<void> decode = pool.enqueue([image_file_path, image, settings]() { decodeImage(image_file_path, *image, settings); });
+	if(!ring) {
+		add(image_file_path, std::move(decode), [image_file_path, image, texture]() { texture->upload(*image, image_file_path); });
+		return;
+	}
+
+	std::shared_ptr<TextureStream> stream = std::make_shared<TextureStream>();
+	stream->texture = texture;
+	stream->image = image;
+	Load load;
+	load.name = image_file_path;
+	load.work = std::move(decode);
+	load.upload = [this, stream](Load& load) { return streamTexture(load, *stream); };
+	loads.push_back(std::move(load));
+}
+
+void AssetLoader::loadVirtualTexture(std::string image_file_path, std::shared_ptr<VirtualTexture> virtual_texture, const VirtualTextureSettings& settings) {
+	add(image_file_path,
+		pool.enqueue([image_file_path, virtual_texture, settings]() { virtual_texture->open(image_file_path, settings); }),
+		[virtual_texture]() { virtual_texture->create(); });
+}
+
+unsigned int AssetLoader::upload(float budget_ms) {
+	std::chrono::high_resolution_clock::time_point frame_start = std::chrono::high_resolution_clock::now();
+	unsigned int count = 0;
+	for(auto it = loads.begin(); it != loads.end();) {
+		if(it->work.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			it++;
+			continue;
+		}
+		// Rethrows what the worker threw
+		it->work.get();
+		if(it->upload(*it)) {
+			it = loads.erase(it);
+			count++;
+			uploaded_count++;
+		}
+		else
+			it++;
+
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - frame_start;
+		if(span.count() >= budget_ms)
+			break;
+	}
+
+	if((count > 0) && loads.empty()) {
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Assets: " << uploaded_count << " loaded in " << span.count() << " ms";
+		if(ring)
+			std::cout << ", " << streamed_bytes / (1024.0f * 1024.0f) << " MB of textures streamed";
+		std::cout << std::endl;
+	}
+	return count;
+}
+
+AssetLoader::~AssetLoader() {
+	for(Load& load : loads)
+		if(load.work.valid())
+			load.work.wait();
+}
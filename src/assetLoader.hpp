@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "texture.hpp"
+#include "threadPool.hpp"
+#include "uploadRing.hpp"
+#include "virtualTexture.hpp"
+
+// Background loading of meshes, shaders and textures
+// File reading, parsing and decoding run on the worker pool, the OpenGL side of each
+// finished load is run by the render thread within a per frame time budget
+// With an upload ring, texture pixels are copied to mapped buffers by the workers and the render thread only
+// issues the copies to the texture, so large textures are spread over frames instead of stalling one
+class AssetLoader {
+private:
+	struct Load {
+		std::string name;
+		std::future<void> work;
+		// False when not done yet, run again once its new work is done (or the next frame)
+		std::function<bool(Load&)> upload;
+	};
+
+	// Texture streamed through the upload ring a piece at a time
+	struct TextureStream {
+		std::shared_ptr<Texture> texture;
+		std::shared_ptr<ImageData> image;
+		std::vector<TexturePiece> pieces;
+		size_t next_piece = 0;
+		int slot = -1;
+	};
+
+	ThreadPool& pool;
+	// Declared before the loads, their copies write into it
+	std::unique_ptr<UploadRing> ring;
+	std::deque<Load> loads;
+	size_t streamed_bytes = 0;
+
+	std::chrono::high_resolution_clock::time_point start;
+	unsigned int uploaded_count = 0;
+
+	void add(std::string name, std::future<void> work, std::function<void()> upload);
+	bool streamTexture(Load& load, TextureStream& stream);
+public:
+	// Textures go through a ring of upload_slots pixel buffers of upload_ring_size bytes in total, when not 0
+	AssetLoader(ThreadPool& pool, size_t upload_ring_size = 0, unsigned int upload_slots = 4);
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// Fill a mesh from its cache or obj file, it reports isUploaded() once done
+	void loadMesh(std::string obj_file_path, std::shared_ptr<Mesh> mesh, const MeshSettings& settings);
+
+	// Read both shader sources, compile is given them on the render thread
+	void loadShader(std::string vertex_file_path, std::string fragment_file_path, std::function<void(const std::string&, const std::string&)> compile);
+
+	// Decode an image, or map its baked cache, the texture reports isUploaded() once done
+	void loadTexture(std::string image_file_path, std::shared_ptr<Texture> texture, const TextureSettings& settings);
+
+	// Map the tiles of an image, baking them when needed, the virtual texture reports isUploaded() once created
+	void loadVirtualTexture(std::string image_file_path, std::shared_ptr<VirtualTexture> virtual_texture, const VirtualTextureSettings& settings);
+
+	// Run the OpenGL side of finished loads until budget_ms is spent, at least one when any is finished
+	// Errors of the background part are thrown from here, returns the number of loads uploaded
+	unsigned int upload(float budget_ms);
+
+	// Loads not uploaded yet
+	size_t pending() const { return loads.size(); }
+
+	// Waits for the copies still writing to the upload ring
+	~AssetLoader();
+};
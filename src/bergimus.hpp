@@ -1,6 +1,6 @@
 #pragma once
 
-#include <GL/glew.h>
+#include "glCalls.hpp"
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <fstream>
@@ -19,6 +19,17 @@
 #include "lights.hpp"
 #include "objects.hpp"
 #include "mathFunk.hpp"
+#include "threadPool.hpp"
+#include "meshRegistry.hpp"
+#include "textureRegistry.hpp"
+#include "shaderRegistry.hpp"
+#include "assetLoader.hpp"
+#include "frustum.hpp"
+#include "frameStats.hpp"
+#include "counters.hpp"
+#include "frameUniforms.hpp"
+#include "renderQueue.hpp"
+#include "constellation.hpp"
 
 #define APPLICATION_FAILURE -1
 #define APPLICATION_SUCCESS 0
@@ -60,9 +71,39 @@ private:
 
 	Json::Value config;
 
+	MeshRegistry meshes;
+	TextureRegistry textures;
+	ShaderRegistry shaders;
 	std::vector<Light> world_lights;
 	std::vector<Object> world_objects;
 
+	// Satellites of the objects drawn as a constellation, null for the objects drawn alone
+	std::vector<std::unique_ptr<Constellation>> constellations;
+
+	std::unique_ptr<ThreadPool> workers;
+	std::unique_ptr<MeshArena> mesh_arena;
+	MeshSettings mesh_settings;
+	TextureSettings texture_settings;
+	VirtualTextureSettings virtual_texture_settings;
+	LodSettings lod_settings;
+
+	// Background loading, null when loading before the first frame
+	std::unique_ptr<ThreadPool> loader_workers;
+	std::unique_ptr<AssetLoader> loader;
+	float upload_budget_ms = 0.0f;
+
+	// Camera and light shared by every program, written once per frame
+	std::unique_ptr<FrameUniforms> frame_uniforms;
+
+	// Draws of the visible objects and lights, sorted by state before being submitted
+	std::unique_ptr<RenderQueue> render_queue;
+
+	bool frustum_culling = true;
+	FrameStats frame_stats;
+	float stats_interval = 0.0f;
+	float stats_time = 0.0f;
+	unsigned int stats_frames = 0;
+
 	uint8_t createObjects();
 	uint8_t drawObjects();
 
@@ -83,6 +124,7 @@ private:
 	float day_hours = 1.0f;
 	float time_multiplier = 1.0f;
 
+	std::chrono::high_resolution_clock::time_point start_time;
 	std::chrono::high_resolution_clock::time_point system_time;
 	std::chrono::high_resolution_clock::time_point past_system_time;
 	std::chrono::duration<float> time_span;
@@ -145,6 +187,42 @@ public:
 };
 
 uint8_t Application::createObjects() {
+	// Loader threads, zero for one per hardware thread and one to load serially
+	unsigned int loader_threads = config["Meshes"]["Loader Threads"].asUInt();
+	if(loader_threads != 1) {
+		workers.reset(new ThreadPool(loader_threads));
+		mesh_settings.pool = workers.get();
+	}
+	mesh_settings.optimize = config["Meshes"]["Optimize"].asBool();
+	mesh_settings.optimize_overdraw = config["Meshes"]["Optimize Overdraw"].asBool();
+	mesh_settings.quantize = config["Meshes"]["Quantize"].asBool();
+	mesh_settings.meshlets = config["Meshes"]["Meshlets"].asBool();
+	if(config["Meshes"]["Shared Buffers"].asBool()) {
+		mesh_arena.reset(new MeshArena(65536, 262144));
+		mesh_settings.arena = mesh_arena.get();
+	}
+	for(unsigned int i = 0; i < config["Meshes"]["LOD"]["Ratios"].size(); i++)
+		mesh_settings.lod_ratios.push_back(config["Meshes"]["LOD"]["Ratios"][i].asFloat());
+	for(unsigned int i = 0; i < config["Meshes"]["LOD"]["Screen Sizes"].size(); i++)
+		lod_settings.screen_sizes.push_back(config["Meshes"]["LOD"]["Screen Sizes"][i].asFloat());
+	lod_settings.hysteresis = config["Meshes"]["LOD"]["Hysteresis"].asFloat();
+	texture_settings.cache = config["Textures"]["Cache"].asBool();
+	if(!config["Textures"]["Virtual Texture"].empty()) {
+		virtual_texture_settings.tile_size = config["Textures"]["Virtual Texture"]["Tile Size"].asUInt();
+		virtual_texture_settings.cache_tiles = config["Textures"]["Virtual Texture"]["Cache Tiles"].asUInt();
+		virtual_texture_settings.uploads_per_frame = config["Textures"]["Virtual Texture"]["Uploads Per Frame"].asUInt();
+	}
+
+	// Read, parse and decode on worker threads, uploading a little every frame
+	if(config["Loading"]["Background"].asBool()) {
+		// Parsing keeps a thread of its own when serial
+		if(!workers)
+			loader_workers.reset(new ThreadPool(1));
+		size_t upload_ring_size = (size_t)(config["Loading"]["Upload Ring MB"].asFloat() * 1024.0f * 1024.0f);
+		loader.reset(new AssetLoader(workers ? *workers : *loader_workers, upload_ring_size, std::max(config["Loading"]["Upload Ring Slots"].asUInt(), 1u)));
+		upload_budget_ms = config["Loading"]["Upload Budget ms"].asFloat();
+	}
+
 	for(char i = 0; !config["Lights"][std::to_string(i)].empty(); i++) {
 		Light new_object;
 		new_object.name = config["Lights"][std::to_string(i)]["Name"].asString();
@@ -159,7 +237,29 @@ uint8_t Application::createObjects() {
 			satellite_number = i;
 		world_objects.push_back(new_object);
 	}
+	constellations.resize(world_objects.size());
 	
+	// Decode every texture of the scene at once, the objects then share them from the registry
+	std::vector<std::shared_ptr<Texture>> preloaded_textures;
+	if(!loader) {
+		std::vector<std::string> texture_paths;
+		std::vector<TextureSettings> path_settings;
+		TextureSettings normal_map_settings = texture_settings;
+		normal_map_settings.normal_map = true;
+		for(char i = 0; i < (char)world_objects.size(); i++) {
+			// Virtual textures are tiled instead
+			if(!config["Objects"][std::to_string(i)]["Virtual Texture"].asBool())
+				texture_paths.push_back(config["Objects"][std::to_string(i)]["Texture"].asString());
+			else
+				texture_paths.push_back("");
+			path_settings.push_back(texture_settings);
+			texture_paths.push_back(config["Objects"][std::to_string(i)]["Normal_Map"].asString());
+			path_settings.push_back(normal_map_settings);
+		}
+		preloaded_textures = textures.preload(texture_paths, path_settings, workers.get());
+	}
+
+	// Background loads finish into the elements, the vectors are not resized past this point
 	for(char i = 0; i < (char)world_lights.size(); i++) {
 		// Define initial settings parameters of light
 		float x_scl = config["Lights"][std::to_string(i)]["Scale"]["X"].asFloat();
@@ -180,8 +280,8 @@ uint8_t Application::createObjects() {
 		model_mat = glm::scale(model_mat, glm::vec3(x_scl, y_scl, z_scl));
 
 		world_lights[i].color = glm::vec3(r_color, g_color, b_color);
-		world_lights[i].createShaderProgram(config["Lights"][std::to_string(i)]["Shader"]["Vertex"].asString(), config["Lights"][std::to_string(i)]["Shader"]["Fragment"].asString());
-		world_lights[i].createBuffer(model_mat, config["Lights"][std::to_string(i)]["Obj File"].asString());
+		world_lights[i].createShaderProgram(shaders, config["Lights"][std::to_string(i)]["Shader"]["Vertex"].asString(), config["Lights"][std::to_string(i)]["Shader"]["Fragment"].asString(), loader.get());
+		world_lights[i].createBuffer(model_mat, meshes, config["Lights"][std::to_string(i)]["Obj File"].asString(), mesh_settings, loader.get());
 	}
 	
 	for(char i = 0; i < (char)world_objects.size(); i++) {
@@ -200,9 +300,32 @@ uint8_t Application::createObjects() {
 		model_mat = glm::rotate(model_mat, glm::radians(angle), glm::vec3(x_rot, y_rot, z_rot));
 		model_mat = glm::scale(model_mat, glm::vec3(x_scl, y_scl, z_scl));
 
-		world_objects[i].createShaderProgram(config["Objects"][std::to_string(i)]["Shader"]["Vertex"].asString(), config["Objects"][std::to_string(i)]["Shader"]["Fragment"].asString());
-		world_objects[i].createBuffer(model_mat, config["Objects"][std::to_string(i)]["Obj File"].asString());
-		world_objects[i].createTexture(config["Objects"][std::to_string(i)]["Texture"].asString(), config["Objects"][std::to_string(i)]["Normal_Map"].asString());
+		world_objects[i].createShaderProgram(shaders, config["Objects"][std::to_string(i)]["Shader"]["Vertex"].asString(), config["Objects"][std::to_string(i)]["Shader"]["Fragment"].asString(), loader.get());
+		world_objects[i].createBuffer(model_mat, meshes, config["Objects"][std::to_string(i)]["Obj File"].asString(), mesh_settings, loader.get());
+		if(config["Objects"][std::to_string(i)]["Virtual Texture"].asBool()) {
+			world_objects[i].createVirtualTexture(config["Objects"][std::to_string(i)]["Texture"].asString(), virtual_texture_settings, loader.get());
+			world_objects[i].createTexture(textures, "", config["Objects"][std::to_string(i)]["Normal_Map"].asString(), texture_settings, loader.get());
+		}
+		else
+			world_objects[i].createTexture(textures, config["Objects"][std::to_string(i)]["Texture"].asString(), config["Objects"][std::to_string(i)]["Normal_Map"].asString(), texture_settings, loader.get());
+
+		// Every satellite of a constellation in one instanced draw, the object transform places a single satellite
+		if(!config["Objects"][std::to_string(i)]["Constellation"].empty()) {
+			ConstellationSettings constellation_settings;
+			constellation_settings.count = config["Objects"][std::to_string(i)]["Constellation"]["Count"].asUInt();
+			constellation_settings.planes = config["Objects"][std::to_string(i)]["Constellation"]["Planes"].asUInt();
+			constellation_settings.phasing = config["Objects"][std::to_string(i)]["Constellation"]["Phasing"].asUInt();
+			constellation_settings.inclination = config["Objects"][std::to_string(i)]["Constellation"]["Inclination"].asFloat();
+			constellation_settings.radius = config["Objects"][std::to_string(i)]["Constellation"]["Orbit Radius"].asFloat();
+			constellation_settings.speed = config["Objects"][std::to_string(i)]["Constellation"]["Orbital Speed[Km/h]"].asFloat()/3600.0f;
+			constellations[i].reset(new Constellation(constellation_settings, model_mat));
+		}
+	}
+	if(!loader) {
+		meshes.printUsage();
+		if(mesh_arena)
+			mesh_arena->printUsage();
+		textures.printUsage();
 	}
 
 	return APPLICATION_SUCCESS;
@@ -210,15 +333,36 @@ uint8_t Application::createObjects() {
 
 uint8_t Application::drawObjects() {
 	glm::vec3 rotation_center;
+	Frustum frustum(projection * view);
+	frame_stats.reset();
 	for(char i = 0; i < (char)world_lights.size(); i++) {
-		model = world_lights[i].model_mat;
 		if(world_lights[i].name.compare("Sun") == 0) {
 			// Rotate around earth
 			rotation_center = world_objects[earth_number].getPosition();
-			model = glm::translate(glm::mat4(1.0f), -rotation_center) * glm::rotate(glm::mat4(1.0f), math::m_2_pi/(day_hours * 3600.0f) * time_multiplier * real_time_sec, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), rotation_center) * model;
+			world_lights[i].model_mat = glm::translate(glm::mat4(1.0f), -rotation_center) * glm::rotate(glm::mat4(1.0f), math::m_2_pi/(day_hours * 3600.0f) * time_multiplier * real_time_sec, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), rotation_center) * world_lights[i].model_mat;
+		}
+	}
+
+	// Camera and light of this frame, every program reads them from the same buffer
+	FrameData frame_data;
+	frame_data.projection = projection;
+	frame_data.view = view;
+	if(!world_lights.empty()) {
+		frame_data.light_position = glm::vec4(world_lights[0].getPosition(), 1.0f);
+		frame_data.light_color = glm::vec4(world_lights[0].color, 1.0f);
+	}
+	frame_uniforms->write(frame_data);
+	render_queue->begin(view, projection);
+
+	for(char i = 0; i < (char)world_lights.size(); i++) {
+		model = world_lights[i].model_mat;
+		if(frustum_culling && !world_lights[i].isVisible(frustum, &model)) {
 			world_lights[i].model_mat = model;
+			frame_stats.culled++;
+			continue;
 		}
-		world_lights[i].draw(&projection, &view, &model);
+		world_lights[i].selectLod(&projection, &view, &model, lod_settings);
+		world_lights[i].enqueue(*render_queue, &model);
 	}
 	satellite_height = glm::length(world_objects[earth_number].getPosition() - world_objects[satellite_number].getPosition());
 	float satellite_angular_speed = satellite_speed/(satellite_height) * time_multiplier * real_time_sec;
@@ -255,8 +399,24 @@ uint8_t Application::drawObjects() {
 			//rotation_center = world_objects[1].getPosition();
 			//model = glm::translate(glm::mat4(1.0f), rotation_center) * glm::rotate(glm::mat4(1.0f), 0.01f * time, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), -rotation_center) * model;
 		}
-		world_objects[i].draw(world_lights, &projection, &view, &model);
+		// Constellations orbit the earth, their satellites move instead of the object
+		if(constellations[i]) {
+			constellations[i]->update(world_objects[earth_number].getPosition(), time_multiplier * real_time_sec, glm::vec3(glm::inverse(view)[3]));
+			world_objects[i].setInstances(constellations[i]->getModels());
+			model = constellations[i]->getNearestModel();
+		}
+		// Keep the motion going while off screen, draw would have stored it, constellations surround the camera
+		if(frustum_culling && !constellations[i] && !world_objects[i].isVisible(frustum, &model)) {
+			world_objects[i].model_mat = model;
+			frame_stats.culled++;
+			continue;
+		}
+		world_objects[i].selectLod(&projection, &view, &model, lod_settings);
+		world_objects[i].streamTiles(&projection, &view, &model, height, &frame_stats);
+		world_objects[i].enqueue(*render_queue, &model);
 	}
+	render_queue->submit(&frame_stats);
+	frame_uniforms->finish();
 
 	// Satellite is Object 2, and the center of view
 	//rotation_center = world_objects[3].getPosition() + glm::vec3(0.0f, 0.0f, 5.0f);
@@ -266,6 +426,8 @@ uint8_t Application::drawObjects() {
 }
 
 uint8_t Application::initializeApplication(std::string config_file) {
+	start_time = std::chrono::high_resolution_clock::now();
+
 	// Open config json file
 	std::fstream config_fstream;
 	config_fstream.open(config_file, std::fstream::in | std::fstream::out);
@@ -279,10 +441,10 @@ uint8_t Application::initializeApplication(std::string config_file) {
 		return APPLICATION_FAILURE;
 	}
 
-	// Set minimum OpenGL version to 3.3 (Modern OpenGL)
-	if(((config["OpenGL"]["Version"]["Major"].asUInt() == 3) && (config["OpenGL"]["Version"]["Minor"].asUInt() < 3)) || (config["OpenGL"]["Version"]["Major"] < 3)) {
-		config["OpenGL"]["Version"]["Major"] = 3;
-		config["OpenGL"]["Version"]["Minor"] = 3;
+	// Set minimum OpenGL version to 4.6, for buffer storage, immutable textures, image copies and gl_DrawID
+	if(((config["OpenGL"]["Version"]["Major"].asUInt() == 4) && (config["OpenGL"]["Version"]["Minor"].asUInt() < 6)) || (config["OpenGL"]["Version"]["Major"] < 4)) {
+		config["OpenGL"]["Version"]["Major"] = 4;
+		config["OpenGL"]["Version"]["Minor"] = 6;
 		// Reopen file
 		config_fstream.close();
 		config_fstream.open(config_file, std::fstream::in | std::fstream::out | std::fstream::trunc);
@@ -352,6 +514,11 @@ uint8_t Application::initializeApplication(std::string config_file) {
 		throw std::runtime_error(std::string("Error initializing GLEW, error: ") + (const char*)glewGetErrorString(glew_err));
 		return APPLICATION_FAILURE;
 	}
+	if(!GLEW_VERSION_4_6) {
+		glfwTerminate();
+		throw std::runtime_error(std::string("OpenGL 4.6 or later is required, the context is ") + (const char*)glGetString(GL_VERSION));
+		return APPLICATION_FAILURE;
+	}
 
 	// Callbacks
 	glfwSetKeyCallback(window, keyCallback);
@@ -361,6 +528,8 @@ uint8_t Application::initializeApplication(std::string config_file) {
 	std::cout << "OpenGL: " << glGetString(GL_VERSION) << std::endl;
 
 	// Create Objects
+	frame_uniforms.reset(new FrameUniforms());
+	render_queue.reset(new RenderQueue());
 	createObjects();
 	glViewport(0, 0, width, height);
 	
@@ -378,6 +547,10 @@ uint8_t Application::initializeApplication(std::string config_file) {
 	time_multiplier = config["Simulation"]["Time Multiplier"].asFloat();
 	satellite_speed = config["Simulation"]["Satellite"]["Orbital Speed[Km/h]"].asFloat()/3600.0f;
 
+	// Culling and statistics
+	frustum_culling = config["View"]["Frustum Culling"].asBool();
+	stats_interval = config["Statistics"]["Interval"].asFloat();
+
 	return APPLICATION_SUCCESS;
 }
 
@@ -398,7 +571,20 @@ uint8_t Application::mainLoop() {
 	past_width = width;
 	past_height = height;
 	system_time = std::chrono::high_resolution_clock::now();
+	bool first_frame = true;
 	while(!glfwWindowShouldClose(window)) {
+		unsigned long frame_gl_calls = counters::glCalls();
+		unsigned long frame_allocations = counters::allocations();
+
+		// Finish the loads that are ready, objects are drawn once all their parts are uploaded
+		if(loader && loader->pending()) {
+			loader->upload(upload_budget_ms);
+			if(!loader->pending()) {
+				meshes.printUsage();
+				textures.printUsage();
+			}
+		}
+
 		// Rendering step
 		glClear(GL_DEPTH_BUFFER_BIT);
 		glClear(GL_COLOR_BUFFER_BIT);
@@ -408,6 +594,11 @@ uint8_t Application::mainLoop() {
 
 		// Swap front and back buffers
 		glfwSwapBuffers(window);
+		if(first_frame) {
+			first_frame = false;
+			std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start_time;
+			std::cout << "First frame after " << span.count() << " ms" << std::endl;
+		}
 		
 		// Update window size
 		glfwGetWindowSize(window, &width, &height);
@@ -444,12 +635,37 @@ uint8_t Application::mainLoop() {
 		system_time = std::chrono::high_resolution_clock::now();
 		time_span = std::chrono::duration_cast<std::chrono::duration<float>>(system_time - past_system_time);
 		real_time_sec = time_span.count();
+
+		// Print the counters of the last frame now and then
+		frame_stats.gl_calls = counters::glCalls() - frame_gl_calls;
+		frame_stats.allocations = counters::allocations() - frame_allocations;
+		stats_time += real_time_sec;
+		stats_frames++;
+		if((stats_interval > 0.0f) && (stats_time >= stats_interval)) {
+			std::cout << "Frame: " << frame_stats.drawn << " drawn, " << frame_stats.culled << " culled, " << frame_stats.instances << " instances, " << frame_stats.draw_calls << " draw calls, meshlets " << frame_stats.meshlets_drawn << " drawn, "
+				<< frame_stats.meshlets_culled << " culled, switches " << frame_stats.program_switches << " program, " << frame_stats.texture_binds << " texture, "
+				<< frame_stats.vertex_array_binds << " vertex array, tiles " << frame_stats.tiles_needed << " needed, " << frame_stats.tiles_uploaded << " uploaded, "
+				<< frame_stats.tiles_missing << " missing, ";
+			if(counters::enabled())
+				std::cout << frame_stats.gl_calls << " GL calls, " << frame_stats.allocations << " allocations, ";
+			std::cout << stats_frames / stats_time << " fps" << std::endl;
+			stats_time = 0.0f;
+			stats_frames = 0;
+		}
 	}
 
 	return APPLICATION_SUCCESS;
 }
 
 uint8_t Application::terminateApplication(){
+	// Release the meshes while the context is still current, pending loads are dropped
+	loader.reset();
+	world_objects.clear();
+	world_lights.clear();
+	constellations.clear();
+	mesh_arena.reset();
+	render_queue.reset();
+	frame_uniforms.reset();
 	glfwTerminate();
 	return APPLICATION_SUCCESS;
 }
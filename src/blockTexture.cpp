@@ -0,0 +1,491 @@
+#include "blockTexture.hpp"
+#include "mappedFile.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#include <stdexcept>
+#include <string.h>
+
+namespace {
+	const unsigned char ktx2_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+	// DDS pixel format flags, capabilities and four character codes
+	const uint32_t dds_alpha_pixels = 0x1;
+	const uint32_t dds_fourcc = 0x4;
+	const uint32_t dds_header_flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+	const uint32_t dds_caps_texture = 0x1000;
+	const uint32_t dds_caps_mipmap = 0x8 | 0x400000;
+	const uint32_t fourcc_dxt1 = 0x31545844;
+	const uint32_t fourcc_dxt5 = 0x35545844;
+	const uint32_t fourcc_dx10 = 0x30315844;
+
+	uint32_t readU32(const unsigned char* data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint64_t readU64(const unsigned char* data) {
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	bool endsWith(const std::string& text, const std::string& suffix) {
+		if(text.size() < suffix.size())
+			return false;
+		std::string end = text.substr(text.size() - suffix.size());
+		std::transform(end.begin(), end.end(), end.begin(), ::tolower);
+		return end == suffix;
+	}
+
+	// sRGB variants share the layout, they are sampled like the jpg/png textures which are not converted either
+	bc::Format dxgiFormat(uint32_t dxgi) {
+		switch(dxgi) {
+			case 71: case 72:
+				return bc::BC1A;
+			case 77: case 78:
+				return bc::BC3;
+			case 98: case 99:
+				return bc::BC7;
+			default:
+				return bc::NONE;
+		}
+	}
+
+	bc::Format vulkanFormat(uint32_t vk_format) {
+		switch(vk_format) {
+			case 131: case 132:
+				return bc::BC1;
+			case 133: case 134:
+				return bc::BC1A;
+			case 137: case 138:
+				return bc::BC3;
+			case 145: case 146:
+				return bc::BC7;
+			default:
+				return bc::NONE;
+		}
+	}
+
+	// Levels stored one after the other from offset, checked against the file size
+	void addLevels(bc::Format format, int width, int height, unsigned int level_count, size_t offset, size_t file_size, std::vector<bc::Level>& levels, std::string file_path) {
+		for(unsigned int i = 0; i < level_count; i++) {
+			bc::Level level;
+			level.width = std::max(width >> i, 1);
+			level.height = std::max(height >> i, 1);
+			level.offset = offset;
+			level.size = bc::levelSize(format, level.width, level.height);
+			if(level.offset + level.size > file_size)
+				throw std::runtime_error(std::string("Truncated texture file: ")+file_path);
+			levels.push_back(level);
+			offset += level.size;
+		}
+	}
+
+	void readDds(const unsigned char* data, size_t size, bc::Format& format, int& width, int& height, std::vector<unsigned char>& blocks, std::vector<bc::Level>& levels, std::string file_path) {
+		if((size < 128) || (memcmp(data, "DDS ", 4) != 0) || (readU32(data + 4) != 124))
+			throw std::runtime_error(std::string("Invalid dds file: ")+file_path);
+		height = readU32(data + 12);
+		width = readU32(data + 16);
+		unsigned int level_count = std::max<uint32_t>(readU32(data + 28), 1);
+		uint32_t pixel_flags = readU32(data + 80);
+		uint32_t fourcc = readU32(data + 84);
+
+		size_t offset = 128;
+		format = bc::NONE;
+		if(pixel_flags & dds_fourcc) {
+			if(fourcc == fourcc_dxt1)
+				format = (pixel_flags & dds_alpha_pixels) ? bc::BC1A : bc::BC1;
+			else if(fourcc == fourcc_dxt5)
+				format = bc::BC3;
+			else if((fourcc == fourcc_dx10) && (size >= 148)) {
+				format = dxgiFormat(readU32(data + 128));
+				// Texture arrays and cube maps are not 2D textures
+				if(readU32(data + 140) > 1)
+					format = bc::NONE;
+				offset = 148;
+			}
+		}
+		if(format == bc::NONE)
+			throw std::runtime_error(std::string("Unsupported dds format, BC1, BC3 or BC7 expected: ")+file_path);
+
+		addLevels(format, width, height, level_count, offset, size, levels, file_path);
+		blocks.assign(data + offset, data + levels.back().offset + levels.back().size);
+		for(bc::Level& level : levels)
+			level.offset -= offset;
+	}
+
+	void readKtx2(const unsigned char* data, size_t size, bc::Format& format, int& width, int& height, std::vector<unsigned char>& blocks, std::vector<bc::Level>& levels, std::string file_path) {
+		if((size < 80) || (memcmp(data, ktx2_identifier, sizeof(ktx2_identifier)) != 0))
+			throw std::runtime_error(std::string("Invalid ktx2 file: ")+file_path);
+		format = vulkanFormat(readU32(data + 12));
+		width = readU32(data + 20);
+		height = readU32(data + 24);
+		uint32_t depth = readU32(data + 28);
+		uint32_t layer_count = readU32(data + 32);
+		uint32_t face_count = readU32(data + 36);
+		unsigned int level_count = std::max<uint32_t>(readU32(data + 40), 1);
+		uint32_t supercompression = readU32(data + 44);
+		if((format == bc::NONE) || (depth > 0) || (layer_count > 1) || (face_count != 1) || (supercompression != 0))
+			throw std::runtime_error(std::string("Unsupported ktx2 texture, a 2D BC1, BC3 or BC7 texture without supercompression is expected: ")+file_path);
+		if(80 + (size_t)level_count * 24 > size)
+			throw std::runtime_error(std::string("Truncated texture file: ")+file_path);
+
+		// The level index gives each level its own place, usually the smallest first in the file
+		size_t block_size = 0;
+		for(unsigned int i = 0; i < level_count; i++) {
+			bc::Level level;
+			level.width = std::max(width >> i, 1);
+			level.height = std::max(height >> i, 1);
+			level.offset = block_size;
+			level.size = bc::levelSize(format, level.width, level.height);
+			uint64_t file_offset = readU64(data + 80 + i * 24);
+			if((readU64(data + 88 + i * 24) != level.size) || (file_offset + level.size > size))
+				throw std::runtime_error(std::string("Invalid ktx2 level size in file: ")+file_path);
+			levels.push_back(level);
+			block_size += level.size;
+		}
+		blocks.resize(block_size);
+		for(unsigned int i = 0; i < level_count; i++)
+			memcpy(&blocks[levels[i].offset], data + readU64(data + 80 + i * 24), levels[i].size);
+	}
+
+	// 565 endpoint, expanded back to 8 bits per channel
+	uint16_t packColor(const float color[3]) {
+		int r = std::min(std::max((int)(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+		int g = std::min(std::max((int)(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+		int b = std::min(std::max((int)(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	void unpackColor(uint16_t packed, int color[3]) {
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// Four color palette of two endpoints, the three color one with transparent black when c0 <= c1 and allowed
+	void colorPalette(uint16_t c0, uint16_t c1, bool three_color, int palette[4][4]) {
+		unpackColor(c0, palette[0]);
+		unpackColor(c1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+		for(unsigned char c = 0; c < 3; c++) {
+			if(three_color && (c0 <= c1)) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			else {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		if(three_color && (c0 <= c1))
+			palette[3][3] = 0;
+	}
+
+	// Nearest palette entry of each pixel, returns the squared error
+	uint32_t colorIndices(const unsigned char pixels[16][4], uint16_t c0, uint16_t c1, uint32_t& indices) {
+		int palette[4][4];
+		colorPalette(c0, c1, false, palette);
+		uint32_t error = 0;
+		indices = 0;
+		for(unsigned char i = 0; i < 16; i++) {
+			uint32_t best_error = UINT32_MAX;
+			uint32_t best = 0;
+			for(uint32_t p = 0; p < 4; p++) {
+				uint32_t pixel_error = 0;
+				for(unsigned char c = 0; c < 3; c++)
+					pixel_error += (pixels[i][c] - palette[p][c]) * (pixels[i][c] - palette[p][c]);
+				if(pixel_error < best_error) {
+					best_error = pixel_error;
+					best = p;
+				}
+			}
+			indices |= best << (2 * i);
+			error += best_error;
+		}
+		return error;
+	}
+
+	// Endpoints ordered for the four color mode, with the indices remapped when swapped
+	void orderEndpoints(uint16_t& c0, uint16_t& c1, uint32_t& indices) {
+		if(c0 > c1)
+			return;
+		std::swap(c0, c1);
+		// 0 <-> 1 and 2 <-> 3
+		indices ^= 0x55555555;
+	}
+
+	// Endpoints along the principal axis of the block colors, refined once by least squares
+	void encodeColorBlock(const unsigned char pixels[16][4], unsigned char* block) {
+		float mean[3] = {0.0f, 0.0f, 0.0f};
+		for(unsigned char i = 0; i < 16; i++)
+			for(unsigned char c = 0; c < 3; c++)
+				mean[c] += pixels[i][c] / 16.0f;
+		float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+		for(unsigned char i = 0; i < 16; i++) {
+			float d[3] = {pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2]};
+			covariance[0] += d[0] * d[0];
+			covariance[1] += d[0] * d[1];
+			covariance[2] += d[0] * d[2];
+			covariance[3] += d[1] * d[1];
+			covariance[4] += d[1] * d[2];
+			covariance[5] += d[2] * d[2];
+		}
+		float axis[3] = {1.0f, 1.0f, 1.0f};
+		for(unsigned char iteration = 0; iteration < 8; iteration++) {
+			float next[3] = {
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+			float length = std::max(std::max(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+			if(length == 0.0f)
+				break;
+			for(unsigned char c = 0; c < 3; c++)
+				axis[c] = next[c] / length;
+		}
+		float axis_length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for(unsigned char c = 0; c < 3; c++)
+			axis[c] /= axis_length;
+
+		// Extent along the axis, inset a little as the extremes are rarely hit exactly
+		float min_t = 0.0f, max_t = 0.0f;
+		for(unsigned char i = 0; i < 16; i++) {
+			float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+			min_t = std::min(min_t, t);
+			max_t = std::max(max_t, t);
+		}
+		float inset = (max_t - min_t) / 16.0f;
+		float end0[3], end1[3];
+		for(unsigned char c = 0; c < 3; c++) {
+			end0[c] = mean[c] + axis[c] * (max_t - inset);
+			end1[c] = mean[c] + axis[c] * (min_t + inset);
+		}
+		uint16_t c0 = packColor(end0);
+		uint16_t c1 = packColor(end1);
+		uint32_t indices;
+		uint32_t error = colorIndices(pixels, c0, c1, indices);
+
+		// Least squares endpoints for the chosen indices
+		const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {0.0f, 0.0f, 0.0f}, bx[3] = {0.0f, 0.0f, 0.0f};
+		for(unsigned char i = 0; i < 16; i++) {
+			float a = weights[(indices >> (2 * i)) & 3];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for(unsigned char c = 0; c < 3; c++) {
+				ax[c] += a * pixels[i][c];
+				bx[c] += b * pixels[i][c];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if(fabsf(determinant) > 1e-6f) {
+			for(unsigned char c = 0; c < 3; c++) {
+				end0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+				end1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+			}
+			uint16_t refined0 = packColor(end0);
+			uint16_t refined1 = packColor(end1);
+			uint32_t refined_indices;
+			uint32_t refined_error = colorIndices(pixels, refined0, refined1, refined_indices);
+			if(refined_error < error) {
+				c0 = refined0;
+				c1 = refined1;
+				indices = refined_indices;
+			}
+		}
+
+		// Equal endpoints decode every index the same in either mode
+		if(c0 == c1)
+			indices = 0;
+		else
+			orderEndpoints(c0, c1, indices);
+		memcpy(block, &c0, 2);
+		memcpy(block + 2, &c1, 2);
+		memcpy(block + 4, &indices, 4);
+	}
+
+	// Eight alpha values between the block minimum and maximum
+	void encodeAlphaBlock(const unsigned char pixels[16][4], unsigned char* block) {
+		int a0 = 0, a1 = 255;
+		for(unsigned char i = 0; i < 16; i++) {
+			a0 = std::max<int>(a0, pixels[i][3]);
+			a1 = std::min<int>(a1, pixels[i][3]);
+		}
+		uint64_t indices = 0;
+		if(a0 > a1) {
+			int palette[8] = {a0, a1};
+			for(unsigned char p = 1; p < 7; p++)
+				palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+			for(unsigned char i = 0; i < 16; i++) {
+				int best_error = 256;
+				uint64_t best = 0;
+				for(uint64_t p = 0; p < 8; p++) {
+					int alpha_error = abs(pixels[i][3] - palette[p]);
+					if(alpha_error < best_error) {
+						best_error = alpha_error;
+						best = p;
+					}
+				}
+				indices |= best << (3 * i);
+			}
+		}
+		block[0] = a0;
+		block[1] = a1;
+		for(unsigned char i = 0; i < 6; i++)
+			block[2 + i] = (indices >> (8 * i)) & 0xFF;
+	}
+}
+
+size_t bc::blockBytes(Format format) {
+	return ((format == BC1) || (format == BC1A)) ? 8 : 16;
+}
+
+size_t bc::levelSize(Format format, int width, int height) {
+	return (size_t)std::max((width + 3) / 4, 1) * std::max((height + 3) / 4, 1) * blockBytes(format);
+}
+
+bool bc::handles(std::string file_path) {
+	return endsWith(file_path, ".dds") || endsWith(file_path, ".ktx2");
+}
+
+unsigned char bc::read(std::string file_path, Format& format, int& width, int& height, std::vector<unsigned char>& blocks, std::vector<Level>& levels) {
+	MappedFile file;
+	file.open(file_path);
+	levels.clear();
+	if(endsWith(file_path, ".ktx2"))
+		readKtx2((const unsigned char*)file.data(), file.size(), format, width, height, blocks, levels, file_path);
+	else
+		readDds((const unsigned char*)file.data(), file.size(), format, width, height, blocks, levels, file_path);
+	return 0;
+}
+
+unsigned char bc::writeDds(std::string file_path, Format format, const std::vector<unsigned char>& blocks, const std::vector<Level>& levels) {
+	if(levels.empty()) {
+		throw std::runtime_error(std::string("No texture levels to write to: ")+file_path);
+		return -1;
+	}
+
+	uint32_t header[32];
+	memset(header, 0, sizeof(header));
+	memcpy(&header[0], "DDS ", 4);
+	header[1] = 124;
+	header[2] = dds_header_flags;
+	header[3] = levels[0].height;
+	header[4] = levels[0].width;
+	header[5] = levels[0].size;
+	header[7] = levels.size();
+	header[19] = 32;
+	header[20] = dds_fourcc | ((format == BC1A) ? dds_alpha_pixels : 0);
+	header[21] = (format == BC3) ? fourcc_dxt5 : ((format == BC7) ? fourcc_dx10 : fourcc_dxt1);
+	header[27] = dds_caps_texture | ((levels.size() > 1) ? dds_caps_mipmap : 0);
+
+	std::ofstream dds_stream(file_path, std::ofstream::binary | std::ofstream::trunc);
+	dds_stream.write((const char*)header, sizeof(header));
+	if(format == BC7) {
+		// DXGI_FORMAT_BC7_UNORM, 2D texture, single element
+		const uint32_t dx10_header[5] = {98, 3, 0, 1, 0};
+		dds_stream.write((const char*)dx10_header, sizeof(dx10_header));
+	}
+	for(const Level& level : levels)
+		dds_stream.write((const char*)&blocks[level.offset], level.size);
+	dds_stream.close();
+	if(!dds_stream.good()) {
+		throw std::runtime_error(std::string("Failed to write texture file: ")+file_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+unsigned char bc::encode(const unsigned char* pixels, int width, int height, int channels, Format format, unsigned char* blocks) {
+	if((format != BC1) && (format != BC3)) {
+		throw std::runtime_error("Only BC1 and BC3 can be encoded");
+		return -1;
+	}
+
+	int blocks_x = std::max((width + 3) / 4, 1);
+	int blocks_y = std::max((height + 3) / 4, 1);
+	unsigned char block_pixels[16][4];
+	for(int by = 0; by < blocks_y; by++)
+		for(int bx = 0; bx < blocks_x; bx++) {
+			for(unsigned char i = 0; i < 16; i++) {
+				int x = std::min(bx * 4 + (i & 3), width - 1);
+				int y = std::min(by * 4 + (i >> 2), height - 1);
+				const unsigned char* pixel = pixels + ((size_t)y * width + x) * channels;
+				for(unsigned char c = 0; c < 3; c++)
+					block_pixels[i][c] = pixel[c];
+				block_pixels[i][3] = (channels == 4) ? pixel[3] : 255;
+			}
+			unsigned char* block = blocks + ((size_t)by * blocks_x + bx) * blockBytes(format);
+			if(format == BC3) {
+				encodeAlphaBlock(block_pixels, block);
+				block += 8;
+			}
+			encodeColorBlock(block_pixels, block);
+		}
+
+	return 0;
+}
+
+unsigned char bc::decode(const unsigned char* blocks, int width, int height, Format format, unsigned char* pixels) {
+	if((format != BC1) && (format != BC1A) && (format != BC3)) {
+		throw std::runtime_error("Only BC1 and BC3 can be decoded");
+		return -1;
+	}
+
+	int blocks_x = std::max((width + 3) / 4, 1);
+	int blocks_y = std::max((height + 3) / 4, 1);
+	for(int by = 0; by < blocks_y; by++)
+		for(int bx = 0; bx < blocks_x; bx++) {
+			const unsigned char* block = blocks + ((size_t)by * blocks_x + bx) * blockBytes(format);
+			int alpha[8];
+			uint64_t alpha_indices = 0;
+			if(format == BC3) {
+				alpha[0] = block[0];
+				alpha[1] = block[1];
+				for(unsigned char p = 1; p < 7; p++) {
+					if(alpha[0] > alpha[1])
+						alpha[p + 1] = ((7 - p) * alpha[0] + p * alpha[1]) / 7;
+					else
+						alpha[p + 1] = (p < 5) ? ((5 - p) * alpha[0] + p * alpha[1]) / 5 : ((p == 5) ? 0 : 255);
+				}
+				for(unsigned char i = 0; i < 6; i++)
+					alpha_indices |= (uint64_t)block[2 + i] << (8 * i);
+				block += 8;
+			}
+
+			uint16_t c0, c1;
+			uint32_t indices;
+			memcpy(&c0, block, 2);
+			memcpy(&c1, block + 2, 2);
+			memcpy(&indices, block + 4, 4);
+			int palette[4][4];
+			colorPalette(c0, c1, format != BC3, palette);
+			if(format == BC1)
+				palette[3][3] = 255;
+
+			for(unsigned char i = 0; i < 16; i++) {
+				int x = bx * 4 + (i & 3);
+				int y = by * 4 + (i >> 2);
+				if((x >= width) || (y >= height))
+					continue;
+				unsigned char* pixel = pixels + ((size_t)y * width + x) * 4;
+				const int* color = palette[(indices >> (2 * i)) & 3];
+				for(unsigned char c = 0; c < 4; c++)
+					pixel[c] = color[c];
+				if(format == BC3)
+					pixel[3] = alpha[(alpha_indices >> (3 * i)) & 7];
+			}
+		}
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Block compressed (BCn) textures: dds/ktx2 reading, BC1/BC3 encoding and dds writing
+// Rows are stored bottom to top like every other texture, texEncode writes them that way
+namespace bc {
+	enum Format {
+		NONE = 0,
+		BC1,	// RGB, 8 bytes per 4x4 block
+		BC1A,	// RGB with 1 bit alpha, 8 bytes per block
+		BC3,	// RGBA, 16 bytes per block
+		BC7		// RGBA, 16 bytes per block, read only
+	};
+
+	// One mip level inside the block data, level 0 first
+	struct Level {
+		int width;
+		int height;
+		size_t offset;
+		size_t size;
+	};
+
+	size_t blockBytes(Format format);
+	size_t levelSize(Format format, int width, int height);
+
+	// .dds and .ktx2 files
+	bool handles(std::string file_path);
+
+	// Read the blocks of every mip level, throws on formats other than BC1/BC3/BC7
+	unsigned char read(std::string file_path, Format& format, int& width, int& height, std::vector<unsigned char>& blocks, std::vector<Level>& levels);
+
+	// Write a dds file holding the given levels
+	unsigned char writeDds(std::string file_path, Format format, const std::vector<unsigned char>& blocks, const std::vector<Level>& levels);
+
+	// Encode 8 bit RGB or RGBA pixels to BC1 or BC3 blocks, edge blocks repeat the last row and column
+	unsigned char encode(const unsigned char* pixels, int width, int height, int channels, Format format, unsigned char* blocks);
+
+	// Decode BC1/BC1A/BC3 blocks to RGBA pixels
+	unsigned char decode(const unsigned char* blocks, int width, int height, Format format, unsigned char* pixels);
+}
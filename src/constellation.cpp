@@ -0,0 +1,52 @@
+#include "constellation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+	const float two_pi = glm::two_pi<float>();
+}
+
+Constellation::Constellation(const ConstellationSettings& settings, const glm::mat4& base_model) : settings(settings), base_model(base_model) {
+	this->settings.count = std::max(settings.count, 1u);
+	this->settings.planes = std::max(std::min(settings.planes, this->settings.count), 1u);
+	for(unsigned int plane = 0; plane < this->settings.planes; plane++) {
+		float ascending_node = two_pi * plane / this->settings.planes;
+		plane_frames.push_back(glm::rotate(glm::mat4(1.0f), ascending_node, glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::rotate(glm::mat4(1.0f), glm::radians(settings.inclination), glm::vec3(1.0f, 0.0f, 0.0f)));
+	}
+	models.resize(this->settings.count, glm::mat4(1.0f));
+}
+
+void Constellation::update(const glm::vec3& center, float seconds, const glm::vec3& camera_position) {
+	angle = std::fmod(angle + settings.speed / settings.radius * seconds, two_pi);
+
+	// Satellites of a plane follow each other evenly spaced, the last count % planes planes hold one more
+	unsigned int per_plane = settings.count / settings.planes;
+	unsigned int smaller_planes = settings.planes - settings.count % settings.planes;
+	glm::mat4 orbit = glm::translate(glm::mat4(1.0f), glm::vec3(settings.radius, 0.0f, 0.0f)) * base_model;
+	glm::mat4 centered = glm::translate(glm::mat4(1.0f), center);
+	float nearest_distance = -1.0f;
+	for(unsigned int i = 0; i < settings.count; i++) {
+		unsigned int plane = i / per_plane;
+		unsigned int slot = i % per_plane;
+		unsigned int plane_count = per_plane;
+		if(plane >= smaller_planes) {
+			unsigned int larger = i - smaller_planes * per_plane;
+			plane = smaller_planes + larger / (per_plane + 1);
+			slot = larger % (per_plane + 1);
+			plane_count = per_plane + 1;
+		}
+		float anomaly = angle + two_pi * slot / plane_count + two_pi * settings.phasing * plane / settings.count;
+		models[i] = centered * plane_frames[plane] * glm::rotate(glm::mat4(1.0f), anomaly, glm::vec3(0.0f, 1.0f, 0.0f)) * orbit;
+
+		glm::vec3 offset = glm::vec3(models[i][3]) - camera_position;
+		float distance = glm::dot(offset, offset);
+		if((nearest_distance < 0.0f) || (distance < nearest_distance)) {
+			nearest_distance = distance;
+			nearest = i;
+		}
+	}
+}
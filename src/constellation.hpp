@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Walker delta constellation: count satellites split over planes of the same inclination, the last count % planes
+// planes holding one more, each plane spacing its own satellites evenly,
+// the planes spread evenly around the polar axis (y)
+struct ConstellationSettings {
+	unsigned int count = 0;
+	unsigned int planes = 1;
+	// Shift between neighbouring planes, in multiples of 360/count degrees
+	unsigned int phasing = 0;
+	float inclination = 0.0f;
+	float radius = 1.0f;
+	// Along the orbits, in distance units per second
+	float speed = 0.0f;
+};
+
+// Model matrices of the satellites of a constellation, moved along their orbits every frame
+class Constellation {
+private:
+	ConstellationSettings settings;
+	glm::mat4 base_model;
+
+	// Plane orientations, computed once
+	std::vector<glm::mat4> plane_frames;
+
+	// Angle travelled along the orbits so far
+	float angle = 0.0f;
+
+	std::vector<glm::mat4> models;
+	size_t nearest = 0;
+
+public:
+	// base_model places the mesh of one satellite, it is then moved onto its orbit
+	Constellation(const ConstellationSettings& settings, const glm::mat4& base_model);
+
+	// Advance the satellites by seconds around center, finding the one nearest to the camera
+	void update(const glm::vec3& center, float seconds, const glm::vec3& camera_position);
+
+	const std::vector<glm::mat4>& getModels() const { return models; }
+
+	// Model of the satellite nearest to the camera, the whole constellation picks its level of detail from it
+	const glm::mat4& getNearestModel() const { return models[nearest]; }
+};
@@ -0,0 +1,67 @@
+#include "counters.hpp"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+namespace {
+	// Worker threads allocate too
+	std::atomic<unsigned long> allocation_count(0);
+}
+
+unsigned long counters::gl_calls = 0;
+
+bool counters::enabled() {
+#ifdef BERGIMUS_COUNTERS
+	return true;
+#else
+	return false;
+#endif
+}
+
+unsigned long counters::glCalls() {
+	return gl_calls;
+}
+
+unsigned long counters::allocations() {
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+#ifdef BERGIMUS_COUNTERS
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void* pointer = malloc(size ? size : 1);
+	if(!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept {
+	return operator new(size, nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	free(pointer);
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+// OpenGL calls and heap allocations since start, only counted when built with BERGIMUS_COUNTERS
+// Calls are counted through glCalls.hpp, allocations by replacing the global operator new
+namespace counters {
+	// Render thread only, like every OpenGL call
+	extern unsigned long gl_calls;
+	inline void countGlCall() { gl_calls++; }
+
+	// False when built without BERGIMUS_COUNTERS, the counts then stay at 0
+	bool enabled();
+
+	unsigned long glCalls();
+	unsigned long allocations();
+}
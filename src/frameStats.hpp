@@ -0,0 +1,34 @@
+#pragma once
+
+// Counters of the last frame, printed every Statistics/Interval seconds
+struct FrameStats {
+	// Objects and lights sent to the GPU and skipped by frustum culling
+	unsigned int drawn = 0;
+	unsigned int culled = 0;
+
+	// Instances of the instanced draws among them
+	unsigned int instances = 0;
+
+	// Draw calls issued for them, a multi draw of many objects counts once
+	unsigned int draw_calls = 0;
+
+	// Meshlets of the drawn objects sent to the GPU and skipped
+	unsigned int meshlets_drawn = 0;
+	unsigned int meshlets_culled = 0;
+
+	// State changes between the sorted draws, draws sharing the state of the previous one change none
+	unsigned int program_switches = 0;
+	unsigned int texture_binds = 0;
+	unsigned int vertex_array_binds = 0;
+
+	// Virtual texture tiles in view, uploaded this frame and still missing after the upload limit
+	unsigned int tiles_needed = 0;
+	unsigned int tiles_uploaded = 0;
+	unsigned int tiles_missing = 0;
+
+	// Whole frame, uploads and event handling included, when built with BERGIMUS_COUNTERS
+	unsigned long gl_calls = 0;
+	unsigned long allocations = 0;
+
+	void reset() { *this = FrameStats(); }
+};
@@ -0,0 +1,56 @@
+#include "frameUniforms.hpp"
+
+#include "glCalls.hpp"
+#include <stdexcept>
+#include <string.h>
+
+FrameUniforms::FrameUniforms(unsigned int slot_count) {
+	// Each slot starts at a multiple of the offset alignment
+	int alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	slot_size = (sizeof(FrameData) + alignment - 1) / alignment * alignment;
+	fences.resize(slot_count, nullptr);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferStorage(GL_UNIFORM_BUFFER, slot_size * slot_count, nullptr, flags);
+	mapping = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, slot_size * slot_count, flags);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	if(!mapping) {
+		glDeleteBuffers(1, &buffer);
+		throw std::runtime_error("Failed to map the frame uniform buffer");
+	}
+}
+
+void FrameUniforms::write(const FrameData& data) {
+	current = (current + 1) % fences.size();
+	if(fences[current]) {
+		// Only blocks when the GPU is more frames behind than there are slots
+		glClientWaitSync((GLsync)fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync((GLsync)fences[current]);
+		fences[current] = nullptr;
+	}
+	memcpy(mapping + current * slot_size, &data, sizeof(FrameData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, frame_data_binding, buffer, current * slot_size, sizeof(FrameData));
+}
+
+void FrameUniforms::finish() {
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+FrameUniforms::~FrameUniforms() {
+	for(void* fence : fences)
+		if(fence)
+			glDeleteSync((GLsync)fence);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+}
+
+void bindFrameBlock(unsigned int shader_program) {
+	unsigned int block = glGetUniformBlockIndex(shader_program, "FrameData");
+	if(block != GL_INVALID_INDEX)
+		glUniformBlockBinding(shader_program, block, frame_data_binding);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Uniform block binding point of the FrameData block, the same for every program
+const unsigned int frame_data_binding = 0;
+
+// Camera and light of a frame, laid out like the std140 FrameData block of the shaders
+struct FrameData {
+	glm::mat4 projection;
+	glm::mat4 view;
+	// xyz, w unused
+	glm::vec4 light_position;
+	glm::vec4 light_color;
+};
+
+// Uniform buffer written once per frame instead of setting the camera and light on every program
+// Persistently mapped with a slot per frame in flight, a slot is only rewritten once the GPU is done
+// with the frame that last used it
+class FrameUniforms {
+private:
+	unsigned int buffer = 0;
+	unsigned char* mapping = nullptr;
+	size_t slot_size = 0;
+
+	// Fence of the frame each slot was last used by, null when free
+	std::vector<void*> fences;
+	unsigned int current = 0;
+
+public:
+	FrameUniforms(unsigned int slot_count = 3);
+	FrameUniforms(const FrameUniforms&) = delete;
+	FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+	// Write the data of this frame to the next slot, waiting for the GPU if needed, and bind it
+	void write(const FrameData& data);
+
+	// Fence the slot once every draw of the frame was issued
+	void finish();
+
+	~FrameUniforms();
+};
+
+// Point the FrameData block of a program at frame_data_binding, programs without one are left as is
+void bindFrameBlock(unsigned int shader_program);
@@ -0,0 +1,35 @@
+#include "frustum.hpp"
+
+Frustum::Frustum(const glm::mat4& view_projection) {
+	// Gribb and Hartmann, each plane is the last row of the matrix plus or minus another row
+	glm::vec4 rows[4];
+	for(unsigned char i = 0; i < 4; i++)
+		rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+	planes[0] = rows[3] + rows[0]; // Left
+	planes[1] = rows[3] - rows[0]; // Right
+	planes[2] = rows[3] + rows[1]; // Bottom
+	planes[3] = rows[3] - rows[1]; // Top
+	planes[4] = rows[3] + rows[2]; // Near
+	planes[5] = rows[3] - rows[2]; // Far
+
+	// Unit normals so the distances compare against radii
+	for(unsigned char i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool Frustum::intersectsSphere(glm::vec3 center, float radius) const {
+	for(unsigned char i = 0; i < 6; i++) {
+		if(glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersectsBox(glm::vec3 center, glm::vec3 extents) const {
+	for(unsigned char i = 0; i < 6; i++) {
+		glm::vec3 normal = glm::vec3(planes[i]);
+		if(glm::dot(normal, center) + planes[i].w < -glm::dot(glm::abs(normal), extents))
+			return false;
+	}
+	return true;
+}
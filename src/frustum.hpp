@@ -0,0 +1,18 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// View frustum as six planes facing inwards, ax + by + cz + d >= 0 inside
+class Frustum {
+private:
+	glm::vec4 planes[6];
+
+public:
+	// Planes of a projection * view matrix, in world space
+	Frustum(const glm::mat4& view_projection);
+
+	// False only when the sphere is entirely outside one of the planes
+	bool intersectsSphere(glm::vec3 center, float radius) const;
+
+	// Same for an axis aligned box given by its center and half extents
+	bool intersectsBox(glm::vec3 center, glm::vec3 extents) const;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// Include in place of GL/glew.h, so OpenGL calls are counted when built with BERGIMUS_COUNTERS
+#ifdef BERGIMUS_COUNTERS
+#include "counters.hpp"
+
+// Every entry point GLEW loads goes through this macro
+#define GLEW_GET_FUN(x) (counters::countGlCall(), x)
+#endif
+
+#include <GL/glew.h>
+
+#ifdef BERGIMUS_COUNTERS
+// OpenGL 1.1 entry points are linked directly instead
+#define glBindTexture(...) (counters::countGlCall(), glBindTexture(__VA_ARGS__))
+#define glBlendFunc(...) (counters::countGlCall(), glBlendFunc(__VA_ARGS__))
+#define glClear(...) (counters::countGlCall(), glClear(__VA_ARGS__))
+#define glClearColor(...) (counters::countGlCall(), glClearColor(__VA_ARGS__))
+#define glCullFace(...) (counters::countGlCall(), glCullFace(__VA_ARGS__))
+#define glDeleteTextures(...) (counters::countGlCall(), glDeleteTextures(__VA_ARGS__))
+#define glDepthFunc(...) (counters::countGlCall(), glDepthFunc(__VA_ARGS__))
+#define glDrawArrays(...) (counters::countGlCall(), glDrawArrays(__VA_ARGS__))
+#define glDrawElements(...) (counters::countGlCall(), glDrawElements(__VA_ARGS__))
+#define glEnable(...) (counters::countGlCall(), glEnable(__VA_ARGS__))
+#define glDisable(...) (counters::countGlCall(), glDisable(__VA_ARGS__))
+#define glFrontFace(...) (counters::countGlCall(), glFrontFace(__VA_ARGS__))
+#define glGetIntegerv(...) (counters::countGlCall(), glGetIntegerv(__VA_ARGS__))
+#define glGenTextures(...) (counters::countGlCall(), glGenTextures(__VA_ARGS__))
+#define glPixelStorei(...) (counters::countGlCall(), glPixelStorei(__VA_ARGS__))
+#define glTexImage2D(...) (counters::countGlCall(), glTexImage2D(__VA_ARGS__))
+#define glTexParameteri(...) (counters::countGlCall(), glTexParameteri(__VA_ARGS__))
+#define glTexSubImage2D(...) (counters::countGlCall(), glTexSubImage2D(__VA_ARGS__))
+#define glViewport(...) (counters::countGlCall(), glViewport(__VA_ARGS__))
+#endif
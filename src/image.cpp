@@ -0,0 +1,123 @@
+#include "image.hpp"
+#include "textureCache.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+#include <string>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+	struct SrgbTable {
+		float linear[256];
+
+		SrgbTable() {
+			for(int i = 0; i < 256; i++) {
+				float value = i / 255.0f;
+				linear[i] = (value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	unsigned char linearToSrgb(float value) {
+		value = (value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+		return (unsigned char)std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f);
+	}
+
+	// Half size level from the one above, odd sizes repeat their last row or column
+	void downsample(const unsigned char* source, int width, int height, int channels, bool normal_map, unsigned char* destination) {
+		static const SrgbTable srgb;
+		int half_width = std::max(width / 2, 1);
+		int half_height = std::max(height / 2, 1);
+		for(int y = 0; y < half_height; y++)
+			for(int x = 0; x < half_width; x++) {
+				const unsigned char* corners[4];
+				int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+				corners[0] = source + ((size_t)y0 * width + x0) * channels;
+				corners[1] = source + ((size_t)y0 * width + x1) * channels;
+				corners[2] = source + ((size_t)y1 * width + x0) * channels;
+				corners[3] = source + ((size_t)y1 * width + x1) * channels;
+				unsigned char* pixel = destination + ((size_t)y * half_width + x) * channels;
+
+				if(normal_map) {
+					float normal[3] = {0.0f, 0.0f, 0.0f};
+					for(unsigned char c = 0; c < 3; c++)
+						for(unsigned char i = 0; i < 4; i++)
+							normal[c] += corners[i][c] / 127.5f - 1.0f;
+					float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+					for(unsigned char c = 0; c < 3; c++)
+						pixel[c] = (unsigned char)std::min(std::max(((length > 0.0f) ? normal[c] / length : 0.0f) * 127.5f + 128.0f, 0.0f), 255.0f);
+				}
+				else
+					for(unsigned char c = 0; c < 3; c++)
+						pixel[c] = linearToSrgb((srgb.linear[corners[0][c]] + srgb.linear[corners[1][c]] + srgb.linear[corners[2][c]] + srgb.linear[corners[3][c]]) * 0.25f);
+
+				// Alpha is coverage, not light
+				if(channels == 4)
+					pixel[3] = (corners[0][3] + corners[1][3] + corners[2][3] + corners[3][3] + 2) / 4;
+			}
+	}
+}
+
+ImageData::~ImageData() {
+	if(pixels)
+		stbi_image_free(pixels);
+}
+
+unsigned char decodeImage(std::string image_file_path, ImageData& image, const TextureSettings& settings) {
+	// Block compressed files are stored bottom to top already
+	if(bc::handles(image_file_path))
+		return bc::read(image_file_path, image.block_format, image.width, image.height, image.level_data, image.levels);
+	if(settings.cache)
+		return btex::read(image_file_path, image, settings);
+
+	// Only read here, set once for every thread in loadTexture and AssetLoader
+	image.pixels = stbi_load(image_file_path.c_str(), &image.width, &image.height, &image.channels, 0);
+
+	// Check if loaded
+	if(!image.pixels) {
+		throw std::runtime_error(std::string("Failed to load texture image: ")+image_file_path);
+		return -1;
+	}
+	if((image.channels != 3) && (image.channels != 4)) {
+		throw std::runtime_error(std::string("Invalid number of channels [")+std::to_string(image.channels)+std::string("] in file: ")+image_file_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+void buildMipChain(const unsigned char* pixels, int width, int height, int channels, bool normal_map, std::vector<unsigned char>& data, std::vector<bc::Level>& levels) {
+	// Every level down to 1x1, tightly packed one after the other
+	levels.clear();
+	size_t size = 0;
+	for(;;) {
+		bc::Level level;
+		level.width = width;
+		level.height = height;
+		level.offset = size;
+		level.size = (size_t)width * height * channels;
+		levels.push_back(level);
+		size += level.size;
+		if((width == 1) && (height == 1))
+			break;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	data.resize(size);
+	std::copy(pixels, pixels + levels[0].size, data.begin());
+	for(size_t i = 1; i < levels.size(); i++)
+		downsample(&data[levels[i - 1].offset], levels[i - 1].width, levels[i - 1].height, channels, normal_map, &data[levels[i].offset]);
+}
+
+void generateMips(ImageData& image, bool normal_map) {
+	buildMipChain(image.pixels, image.width, image.height, image.channels, normal_map, image.level_data, image.levels);
+
+	// The first level holds them now
+	stbi_image_free(image.pixels);
+	image.pixels = nullptr;
+}
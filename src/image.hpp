@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "blockTexture.hpp"
+#include "mappedFile.hpp"
+
+// How an image file is turned into a texture
+struct TextureSettings {
+	// Bake the decoded mip chain to a .btex file next to the image and map it on later loads
+	bool cache = false;
+	// Mip levels of normal maps are averaged and renormalized instead of averaged in linear light
+	bool normal_map = false;
+};
+
+// Decoded image, rows bottom to top as OpenGL expects
+// Either 8 bits per channel pixels, a baked mip chain of them, or block compressed data with its mip chain
+class ImageData {
+public:
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* pixels = nullptr;
+
+	bc::Format block_format = bc::NONE;
+	std::vector<unsigned char> level_data;
+	std::vector<bc::Level> levels;
+
+	// Level offsets point into it instead of level_data when read from a cache
+	MappedFile mapped;
+
+	ImageData() = default;
+	ImageData(const ImageData&) = delete;
+	ImageData& operator=(const ImageData&) = delete;
+
+	bool isCompressed() const { return block_format != bc::NONE; }
+	bool hasLevels() const { return !levels.empty(); }
+
+	const unsigned char* levelData(size_t level) const {
+		return (mapped.isOpen() ? (const unsigned char*)mapped.data() : level_data.data()) + levels[level].offset;
+	}
+
+	~ImageData();
+};
+
+// Decode a jpg/png file or read a dds/ktx2 one, does not touch OpenGL so it is safe to call from worker threads
+// With settings.cache jpg/png files are read from their baked mip chain, decoded and baked when missing or outdated
+unsigned char decodeImage(std::string image_file_path, ImageData& image, const TextureSettings& settings = TextureSettings());
+
+// Full mip chain of 8 bit pixels down to 1x1, 2x2 box filtered, the first level being a copy of the pixels
+void buildMipChain(const unsigned char* pixels, int width, int height, int channels, bool normal_map, std::vector<unsigned char>& data, std::vector<bc::Level>& levels);
+
+// Replace the decoded pixels with their full mip chain
+void generateMips(ImageData& image, bool normal_map);
@@ -0,0 +1,18 @@
+#include "instances.hpp"
+
+#include "glCalls.hpp"
+
+void InstanceBuffer::update(const std::vector<glm::mat4>& models) {
+	if(!buffer)
+		glGenBuffers(1, &buffer);
+	count = models.size();
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(glm::mat4), models.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+	if(buffer)
+		glDeleteBuffers(1, &buffer);
+}
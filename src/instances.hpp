@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Binding of the Instances shader storage block, read by instanced_shader.vert at gl_InstanceID
+const unsigned int instance_binding = 1;
+
+// Model matrix of every instance of an object, rewritten every frame
+// Read from a storage buffer rather than vertex attributes, the vertex array of the mesh is shared
+// with the objects drawing it alone
+class InstanceBuffer {
+private:
+	unsigned int buffer = 0;
+	size_t count = 0;
+
+public:
+	InstanceBuffer() = default;
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	// Orphan the previous contents, the GPU may still be drawing them, and upload the new ones
+	void update(const std::vector<glm::mat4>& models);
+
+	unsigned int getId() const { return buffer; }
+	size_t getCount() const { return count; }
+
+	~InstanceBuffer();
+};
@@ -4,20 +4,22 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include "mesh.hpp"
+#include "meshRegistry.hpp"
+#include "assetLoader.hpp"
+#include "frustum.hpp"
+#include "frameStats.hpp"
+#include "shaderRegistry.hpp"
+#include "renderQueue.hpp"
+
 class Light {
 private:
-	std::string shader_vert_file;
-	std::string shader_frag_file;
-
 	std::string obj_file;
 
-	unsigned int shader_program;
+	std::shared_ptr<ShaderProgram> shader;
 
-	unsigned int vertex_buffer;
-	unsigned int vertex_array;
-	unsigned int index_buffer;
-
-	unsigned int element_count = 0;
+	std::shared_ptr<Mesh> mesh;
+	unsigned int lod_level = 0;
 
 	unsigned int position_size;
 	unsigned int texture_size;
@@ -32,12 +34,17 @@ public:
 	std::string name;
 	glm::mat4 model_mat = glm::mat4(1.0f);
 
-	unsigned char createBuffer(glm::mat4 initial_mat, std::string obj_file_path = "");
-	unsigned char createShaderProgram(std::string shader_vertex, std::string shader_fragment);
-	unsigned char draw(glm::mat4* projection, glm::mat4* view, glm::mat4* model);
+	unsigned char createBuffer(glm::mat4 initial_mat, MeshRegistry& meshes, std::string obj_file_path = "", const MeshSettings& settings = MeshSettings(), AssetLoader* loader = nullptr);
+	unsigned char createShaderProgram(ShaderRegistry& shaders, std::string shader_vertex, std::string shader_fragment, AssetLoader* loader = nullptr);
+	unsigned char selectLod(glm::mat4* projection, glm::mat4* view, glm::mat4* model, const LodSettings& settings);
+	unsigned char enqueue(RenderQueue& queue, glm::mat4* model);
+
+	// Drawn once its shader and mesh are loaded
+	bool isReady() const { return shader && shader->isReady() && mesh && mesh->isUploaded(); }
 
-	glm::vec3 getPosition();
-	glm::quat getRotation();
+	// Mesh bounds under the model matrix intersect the frustum
+	bool isVisible(const Frustum& frustum, glm::mat4* model) const { return mesh && mesh->isVisible(frustum, *model); }
 
-	~Light();
+	glm::vec3 getPosition() const;
+	glm::quat getRotation() const;
 };
@@ -0,0 +1,92 @@
+#include "mappedFile.hpp"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <functional>
+#include <thread>
+
+unsigned char MappedFile::open(std::string file_path) {
+	close();
+
+	file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+	if(file_descriptor < 0) {
+		throw std::runtime_error(std::string("Failed to open file: ")+file_path);
+		return -1;
+	}
+
+	struct stat file_stat;
+	if(fstat(file_descriptor, &file_stat) != 0) {
+		close();
+		throw std::runtime_error(std::string("Failed to stat file: ")+file_path);
+		return -1;
+	}
+	file_size = file_stat.st_size;
+
+	// Empty files can not be mapped, leave them as a valid zero sized view
+	if(file_size == 0)
+		return 0;
+
+	mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	if(mapping == MAP_FAILED) {
+		mapping = nullptr;
+		close();
+		throw std::runtime_error(std::string("Failed to map file: ")+file_path);
+		return -1;
+	}
+	// The whole file is read front to back
+	madvise(mapping, file_size, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+void MappedFile::close() {
+	if(mapping)
+		munmap(mapping, file_size);
+	if(file_descriptor >= 0)
+		::close(file_descriptor);
+	mapping = nullptr;
+	file_descriptor = -1;
+	file_size = 0;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool getSourceInfo(std::string file_path, SourceInfo& info) {
+	struct stat file_stat;
+	if(stat(file_path.c_str(), &file_stat) != 0)
+		return false;
+	info.size = file_stat.st_size;
+	info.mtime = (int64_t)file_stat.st_mtim.tv_sec * 1000000000 + file_stat.st_mtim.tv_nsec;
+	return true;
+}
+
+std::string canonicalPath(std::string file_path) {
+	char resolved[PATH_MAX];
+	if(!realpath(file_path.c_str(), resolved))
+		return file_path;
+	return std::string(resolved);
+}
+
+std::string temporaryPath(std::string file_path) {
+	size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+	return file_path + "." + std::to_string(getpid()) + "." + std::to_string(thread) + ".tmp";
+}
+
+uint64_t hashFile(std::string file_path) {
+	MappedFile file;
+	file.open(file_path);
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const unsigned char* data = (const unsigned char*)file.data();
+	for(size_t i = 0; i < file.size(); i++) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
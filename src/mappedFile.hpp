@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+// Read only memory mapping of a whole file, released on destruction
+class MappedFile {
+private:
+	int file_descriptor = -1;
+	void* mapping = nullptr;
+	size_t file_size = 0;
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	unsigned char open(std::string file_path);
+	void close();
+
+	const char* data() const { return (const char*)mapping; }
+	size_t size() const { return file_size; }
+	bool isOpen() const { return file_descriptor >= 0; }
+
+	~MappedFile();
+};
+
+// Size and modification time of a file, stored by the caches to detect a changed source
+struct SourceInfo {
+	uint64_t size;
+	int64_t mtime;
+};
+
+bool getSourceInfo(std::string file_path, SourceInfo& info);
+
+// Resolve links and relative components so every spelling of a file shares one registry entry,
+// a missing file is returned as is for its loader to report
+std::string canonicalPath(std::string file_path);
+
+// file_path.<pid>.<thread>.tmp, unique to the calling thread, for writing a file before renaming it into place
+std::string temporaryPath(std::string file_path);
+
+// FNV-1a over the file bytes, only computed when the modification time changed
+uint64_t hashFile(std::string file_path);
@@ -0,0 +1,352 @@
+#include "mesh.hpp"
+#include "frustum.hpp"
+#include "meshlets.hpp"
+
+#include "glCalls.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string.h>
+
+namespace {
+	uint16_t packUnorm16(float value) {
+		return (uint16_t)std::round(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+	}
+
+	int16_t packSnorm16(float value) {
+		return (int16_t)std::round(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+	}
+
+	// IEEE half float, rounded to nearest, out of range values saturate to infinity
+	uint16_t packHalf(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint16_t sign = (bits >> 16) & 0x8000;
+		int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFF;
+		if(exponent >= 31)
+			return sign | 0x7C00;
+		if(exponent <= 0) {
+			if(exponent < -10)
+				return sign;
+			mantissa |= 0x800000;
+			unsigned int shift = 14 - exponent;
+			return sign | (uint16_t)((mantissa + (1u << (shift - 1))) >> shift);
+		}
+		uint16_t half = sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+		// Round to nearest, a carry correctly moves into the exponent
+		if(mantissa & 0x1000)
+			half++;
+		return half;
+	}
+}
+
+unsigned char Mesh::upload(const MeshData& mesh, bool quantize, MeshArena* arena) {
+	bounds_min = mesh.bounds_min;
+	bounds_max = mesh.bounds_max;
+	if(useShortIndices(mesh.vertices.size())) {
+		std::vector<uint16_t> short_indices(mesh.indices.begin(), mesh.indices.end());
+		upload(mesh.vertices.data(), mesh.vertices.size(), short_indices.data(), short_indices.size(), sizeof(uint16_t), quantize, arena);
+	}
+	else
+		upload(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), sizeof(unsigned int), quantize, arena);
+	if(!mesh.lod_counts.empty())
+		setLods(mesh.lod_counts.data(), mesh.lod_counts.size());
+	if(!mesh.meshlets.empty())
+		setMeshlets(mesh.meshlets.data(), mesh.meshlets.size());
+	return 0;
+}
+
+unsigned char Mesh::upload(const Vertex* vertices, size_t vertex_count, const void* indices, size_t index_count, unsigned int index_size, bool quantize, MeshArena* arena) {
+	meshlets.clear();
+	quantized = quantize;
+
+	// Quantized layouts differ between meshes, those keep buffers of their own
+	if(arena && !quantized) {
+		this->arena = arena;
+		allocation = arena->add(vertices, vertex_count, indices, index_count, index_size);
+		vertex_array = arena->getVertexArray(allocation.index_size);
+		this->index_size = allocation.index_size;
+		index_type = (allocation.index_size == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		first_index = allocation.first_index;
+		base_vertex = allocation.first_vertex;
+	}
+	else
+		uploadBuffers(vertices, vertex_count, indices, index_count, index_size);
+
+	// Sphere around the box center, tighter than the box corners for round meshes
+	bounding_center = 0.5f * (bounds_min + bounds_max);
+	bounding_radius = 0.0f;
+	for(size_t i = 0; i < vertex_count; i++)
+		bounding_radius = std::max(bounding_radius, glm::length(vertices[i].position - bounding_center));
+
+	// Save the amount of elements to draw, a single level until told otherwise
+	element_count = index_count;
+	lod_count = 1;
+	lod_offsets[0] = 0;
+	lod_counts[0] = index_count;
+	return 0;
+}
+
+void Mesh::uploadBuffers(const Vertex* vertices, size_t vertex_count, const void* indices, size_t index_count, unsigned int index_size) {
+	// Create buffers
+	glGenVertexArrays(1, &vertex_array);
+	glGenBuffers(1, &vertex_buffer);
+	glGenBuffers(1, &index_buffer);
+
+	// Bind buffers and send data
+	glBindVertexArray(vertex_array);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	std::vector<PackedVertex> packed;
+	bool textures_unorm = false;
+	if(quantized) {
+		packVertices(vertices, vertex_count, bounds_min, bounds_max, packed, textures_unorm);
+		glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * index_size, indices, GL_STATIC_DRAW);
+	this->index_size = index_size;
+	index_type = (index_size == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	// Position for shaders, matching the locations bound before linking
+	int attribute_location = 0;
+
+	// Position
+	if(quantized)
+		glVertexAttribPointer(attribute_location, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)(offsetof(PackedVertex, position)));
+	else
+		glVertexAttribPointer(attribute_location, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, position)));
+	glEnableVertexAttribArray(attribute_location);
+	attribute_location++;
+
+	// Texture
+	if(quantized && textures_unorm)
+		glVertexAttribPointer(attribute_location, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)(offsetof(PackedVertex, texture)));
+	else if(quantized)
+		glVertexAttribPointer(attribute_location, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)(offsetof(PackedVertex, texture)));
+	else
+		glVertexAttribPointer(attribute_location, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, texture)));
+	glEnableVertexAttribArray(attribute_location);
+	attribute_location++;
+
+	// Normal, the shader decodes the octahedral pair when quantized
+	if(quantized)
+		glVertexAttribPointer(attribute_location, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)(offsetof(PackedVertex, normal)));
+	else
+		glVertexAttribPointer(attribute_location, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
+	glEnableVertexAttribArray(attribute_location);
+	attribute_location++;
+
+	// Unbind, the vertex array keeps the index buffer binding
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::setLods(const unsigned int* counts, unsigned int count) {
+	lod_count = 0;
+	unsigned int offset = 0;
+	for(unsigned int i = 0; (i < count) && (i < max_lods) && (offset + counts[i] <= element_count); i++) {
+		lod_offsets[i] = offset;
+		lod_counts[i] = counts[i];
+		offset += counts[i];
+		lod_count++;
+	}
+	if(lod_count == 0) {
+		lod_count = 1;
+		lod_offsets[0] = 0;
+		lod_counts[0] = element_count;
+	}
+}
+
+void Mesh::setMeshlets(const Meshlet* clusters, size_t count) {
+	meshlets.clear();
+	for(size_t i = 0; i < count; i++) {
+		// Only ranges within the first level are kept
+		if(clusters[i].index_offset + clusters[i].index_count > lod_counts[0])
+			continue;
+		meshlets.push_back(clusters[i]);
+	}
+	draw_counts.reserve(meshlets.size());
+	draw_offsets.reserve(meshlets.size());
+	draw_base_vertices.reserve(meshlets.size());
+}
+
+bool Mesh::isVisible(const Frustum& frustum, const glm::mat4& model) const {
+	// Sphere first, scaled by the largest axis of the model
+	glm::vec3 center = glm::vec3(model * glm::vec4(bounding_center, 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	if(!frustum.intersectsSphere(center, bounding_radius * scale))
+		return false;
+
+	// Then the world box enclosing the transformed bounds
+	glm::vec3 box_center = glm::vec3(model * glm::vec4(0.5f * (bounds_min + bounds_max), 1.0f));
+	glm::vec3 half_extents = 0.5f * (bounds_max - bounds_min);
+	glm::vec3 extents = glm::abs(glm::vec3(model[0])) * half_extents.x + glm::abs(glm::vec3(model[1])) * half_extents.y + glm::abs(glm::vec3(model[2])) * half_extents.z;
+	return frustum.intersectsBox(box_center, extents);
+}
+
+float Mesh::screenSize(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const {
+	// Bounding sphere in world space, scaled by the largest axis of the model
+	glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (bounds_min + bounds_max), 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float radius = 0.5f * glm::length(bounds_max - bounds_min) * scale;
+
+	float distance = -(view * glm::vec4(center, 1.0f)).z;
+	if(distance <= radius)
+		return 1.0f;
+	// projection[1][1] is cot(fov/2), the viewport spans 2 units
+	return radius * projection[1][1] / distance;
+}
+
+unsigned int Mesh::selectLod(float screen_size, unsigned int current_lod, const LodSettings& settings) const {
+	// Finest level whose threshold the size is still under
+	unsigned int lod = 0;
+	while((lod < settings.screen_sizes.size()) && (lod + 1 < lod_count) && (screen_size < settings.screen_sizes[lod]))
+		lod++;
+
+	// Back toward the current level, one step at a time, while the threshold crossed is still inside the hysteresis margin
+	while((lod > current_lod) && (screen_size > settings.screen_sizes[lod - 1] * (1.0f - settings.hysteresis)))
+		lod--;
+	while((lod < current_lod) && (lod < settings.screen_sizes.size()) && (screen_size < settings.screen_sizes[lod] * (1.0f + settings.hysteresis)))
+		lod++;
+	return std::min(lod, lod_count - 1);
+}
+
+unsigned char Mesh::draw(unsigned int lod) {
+	lod = std::min(lod, lod_count - 1);
+	glDrawElementsBaseVertex(GL_TRIANGLES, lod_counts[lod], index_type, (void*)((size_t)(first_index + lod_offsets[lod]) * index_size), base_vertex);
+	return 0;
+}
+
+unsigned char Mesh::drawInstanced(unsigned int lod, unsigned int instance_count) {
+	lod = std::min(lod, lod_count - 1);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod_counts[lod], index_type, (void*)((size_t)(first_index + lod_offsets[lod]) * index_size), instance_count, base_vertex);
+	return 0;
+}
+
+void Mesh::cullMeshlets(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, unsigned int& drawn, unsigned int& culled) {
+	// Culling in mesh space, the frustum planes of the whole transform and the camera moved back by it
+	glm::mat4 model_view = view * model;
+	Frustum frustum(projection * model_view);
+	glm::vec3 camera_position = glm::vec3(glm::inverse(model_view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+	draw_counts.clear();
+	draw_offsets.clear();
+	unsigned int next_offset = 0;
+	for(size_t i = 0; i < meshlets.size(); i++) {
+		if(meshlets::isCulled(meshlets[i], frustum, camera_position)) {
+			culled++;
+			continue;
+		}
+		drawn++;
+		// Extend the previous range when this meshlet follows it
+		if(!draw_counts.empty() && (meshlets[i].index_offset == next_offset))
+			draw_counts.back() += meshlets[i].index_count;
+		else {
+			draw_counts.push_back(meshlets[i].index_count);
+			draw_offsets.push_back((const void*)((size_t)(first_index + meshlets[i].index_offset) * index_size));
+		}
+		next_offset = meshlets[i].index_offset + meshlets[i].index_count;
+	}
+}
+
+unsigned char Mesh::drawMeshlets(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, unsigned int& drawn, unsigned int& culled) {
+	cullMeshlets(model, view, projection, drawn, culled);
+	if(draw_counts.empty())
+		return 0;
+	draw_base_vertices.assign(draw_counts.size(), base_vertex);
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, draw_counts.data(), index_type, draw_offsets.data(), draw_counts.size(), draw_base_vertices.data());
+	return 0;
+}
+
+size_t Mesh::appendCommands(unsigned int lod, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, std::vector<DrawCommand>& commands, unsigned int& drawn, unsigned int& culled) {
+	DrawCommand command = {0, 1, 0, base_vertex, 0};
+	lod = std::min(lod, lod_count - 1);
+	if((lod > 0) || meshlets.empty()) {
+		command.count = lod_counts[lod];
+		command.first_index = first_index + lod_offsets[lod];
+		commands.push_back(command);
+		return 1;
+	}
+
+	// One command per range of visible meshlets
+	cullMeshlets(model, view, projection, drawn, culled);
+	for(size_t i = 0; i < draw_counts.size(); i++) {
+		command.count = draw_counts[i];
+		command.first_index = (size_t)draw_offsets[i] / index_size;
+		commands.push_back(command);
+	}
+	return draw_counts.size();
+}
+
+Mesh::~Mesh() {
+	// The arena keeps its buffers for the other meshes
+	if(arena) {
+		arena->release(allocation);
+		return;
+	}
+	// Zero names are ignored, a mesh never uploaded deletes nothing
+	glDeleteVertexArrays(1, &vertex_array);
+	glDeleteBuffers(1, &vertex_buffer);
+	glDeleteBuffers(1, &index_buffer);
+}
+
+void printMeshSize(std::string name, const MeshData& mesh) {
+	// One index per corner, compared against one vertex per corner with 32 bit indices
+	size_t corner_count = mesh.indices.size();
+	size_t unwelded_bytes = corner_count * (sizeof(Vertex) + sizeof(unsigned int));
+	size_t welded_bytes = mesh.vertices.size() * sizeof(Vertex) + corner_count * (useShortIndices(mesh.vertices.size()) ? sizeof(uint16_t) : sizeof(unsigned int));
+	std::cout << "Mesh " << name << ": " << corner_count << " corners, " << mesh.vertices.size() << " vertices, "
+		<< unwelded_bytes << " -> " << welded_bytes << " buffer bytes";
+	if(unwelded_bytes > 0)
+		std::cout << " (" << 100 - (100 * welded_bytes) / unwelded_bytes << "% smaller)";
+	std::cout << std::endl;
+}
+
+void packVertices(const Vertex* vertices, size_t vertex_count, glm::vec3 bounds_min, glm::vec3 bounds_max, std::vector<PackedVertex>& packed, bool& textures_unorm) {
+	textures_unorm = true;
+	for(size_t i = 0; i < vertex_count; i++) {
+		const glm::vec2& texture = vertices[i].texture;
+		if((texture.x < 0.0f) || (texture.x > 1.0f) || (texture.y < 0.0f) || (texture.y > 1.0f)) {
+			textures_unorm = false;
+			break;
+		}
+	}
+
+	glm::vec3 extent = bounds_max - bounds_min;
+	glm::vec3 inverse_extent;
+	for(unsigned char i = 0; i < 3; i++)
+		inverse_extent[i] = (extent[i] > 0.0f) ? 1.0f / extent[i] : 0.0f;
+
+	packed.resize(vertex_count);
+	for(size_t i = 0; i < vertex_count; i++) {
+		const Vertex& vertex = vertices[i];
+		PackedVertex& target = packed[i];
+
+		glm::vec3 position = (vertex.position - bounds_min) * inverse_extent;
+		for(unsigned char j = 0; j < 3; j++)
+			target.position[j] = packUnorm16(position[j]);
+		target.position[3] = 0;
+
+		for(unsigned char j = 0; j < 2; j++)
+			target.texture[j] = textures_unorm ? packUnorm16(vertex.texture[j]) : packHalf(vertex.texture[j]);
+
+		// Project on the octahedron and fold the lower half over the upper one
+		glm::vec3 normal = vertex.normal;
+		float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		glm::vec2 octahedral(0.0f);
+		if(sum > 0.0f) {
+			octahedral = glm::vec2(normal.x, normal.y) / sum;
+			if(normal.z < 0.0f) {
+				octahedral = glm::vec2((1.0f - std::abs(octahedral.y)) * (octahedral.x >= 0.0f ? 1.0f : -1.0f),
+					(1.0f - std::abs(octahedral.x)) * (octahedral.y >= 0.0f ? 1.0f : -1.0f));
+			}
+		}
+		target.normal[0] = packSnorm16(octahedral.x);
+		target.normal[1] = packSnorm16(octahedral.y);
+	}
+}
@@ -0,0 +1,206 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include "meshArena.hpp"
+
+class ThreadPool;
+class Frustum;
+
+// Levels of detail a mesh can hold
+const unsigned int max_lods = 8;
+
+// Options applied when loading meshes, read from the "Meshes" block of the config
+struct MeshSettings {
+	// Worker pool used to parse large files, serial when null
+	ThreadPool* pool = nullptr;
+
+	// Reorder for the vertex cache and vertex fetch, optionally for overdraw too
+	bool optimize = false;
+	bool optimize_overdraw = false;
+
+	// Split the finest level into meshlets culled one by one
+	bool meshlets = false;
+
+	// Upload vertices in the 16 byte PackedVertex layout
+	bool quantize = false;
+
+	// Shared buffers the meshes are suballocated from, buffers of their own when null or quantizing
+	MeshArena* arena = nullptr;
+
+	// Triangle ratio of each level of detail, starting with the full mesh (1.0)
+	std::vector<float> lod_ratios;
+};
+
+// Level of detail selection from the projected size of a mesh
+struct LodSettings {
+	// Screen height fraction below which each coarser level is used, decreasing
+	std::vector<float> screen_sizes;
+
+	// Relative margin around each threshold before switching back
+	float hysteresis = 0.0f;
+};
+
+// Interleaved vertex layout shared by every mesh sent to the GPU
+struct Vertex {
+	glm::vec3 position;
+	glm::vec2 texture;
+	glm::vec3 normal;
+};
+
+// Quantized vertex layout, half the size of Vertex
+struct PackedVertex {
+	// Unsigned normalized within the mesh bounds, the last one is padding
+	uint16_t position[4];
+	// Unsigned normalized when every coordinate is within [0, 1], half floats otherwise
+	uint16_t texture[2];
+	// Signed normalized octahedral encoding
+	int16_t normal[2];
+};
+
+// Cluster of the finest level of detail, a contiguous range of the index buffer
+// Culled when outside the frustum or when the camera sees the back of every face (normal cone)
+struct Meshlet {
+	uint32_t index_offset;
+	uint32_t index_count;
+	float center[3];
+	float radius;
+	// Average face normal, with the sine of the widest angle to a face normal (above 1 when never back facing)
+	float cone_axis[3];
+	float cone_cutoff;
+};
+
+// CPU side mesh, ready to be uploaded
+struct MeshData {
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	// Index count of each level of detail stored one after the other in indices, empty for a single level
+	std::vector<unsigned int> lod_counts;
+
+	// Clusters of the first level, empty when not built
+	std::vector<Meshlet> meshlets;
+
+	glm::vec3 bounds_min = glm::vec3(0.0f);
+	glm::vec3 bounds_max = glm::vec3(0.0f);
+};
+
+// Axis aligned bounds of the vertex positions
+inline void computeBounds(MeshData& mesh) {
+	if(mesh.vertices.empty()) {
+		mesh.bounds_min = mesh.bounds_max = glm::vec3(0.0f);
+		return;
+	}
+	mesh.bounds_min = mesh.bounds_max = mesh.vertices[0].position;
+	for(size_t i = 1; i < mesh.vertices.size(); i++) {
+		mesh.bounds_min = glm::min(mesh.bounds_min, mesh.vertices[i].position);
+		mesh.bounds_max = glm::max(mesh.bounds_max, mesh.vertices[i].position);
+	}
+}
+
+// 16 bit indices are enough to address the whole vertex array
+inline bool useShortIndices(size_t vertex_count) {
+	return vertex_count <= 65536;
+}
+
+// Print the buffer size saved by welding against one vertex per corner
+void printMeshSize(std::string name, const MeshData& mesh);
+
+// Pack vertices against the bounds, textures_unorm tells which texture encoding was used
+void packVertices(const Vertex* vertices, size_t vertex_count, glm::vec3 bounds_min, glm::vec3 bounds_max, std::vector<PackedVertex>& packed, bool& textures_unorm);
+
+// GPU side mesh, vertex array with its vertex and index buffers
+class Mesh {
+private:
+	unsigned int vertex_array = 0;
+	unsigned int vertex_buffer = 0;
+	unsigned int index_buffer = 0;
+
+	unsigned int element_count = 0;
+	unsigned int index_type = 0;
+	unsigned int index_size = 0;
+
+	unsigned int lod_count = 1;
+	unsigned int lod_offsets[max_lods] = {0};
+	unsigned int lod_counts[max_lods] = {0};
+
+	bool quantized = false;
+
+	// Range of the shared buffers holding the mesh, null arena for buffers of its own
+	MeshArena* arena = nullptr;
+	MeshAllocation allocation;
+	unsigned int first_index = 0;
+	// Added to every index, the arena keeps them local to the mesh
+	unsigned int base_vertex = 0;
+
+	// Clusters of the first level, with the ranges of the last visible ones merged when contiguous
+	std::vector<Meshlet> meshlets;
+	std::vector<int> draw_counts;
+	std::vector<const void*> draw_offsets;
+	std::vector<int> draw_base_vertices;
+
+	void uploadBuffers(const Vertex* vertices, size_t vertex_count, const void* indices, size_t index_count, unsigned int index_size);
+
+	// Ranges of the meshlets left after culling into draw_counts and draw_offsets
+	void cullMeshlets(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, unsigned int& drawn, unsigned int& culled);
+
+public:
+	glm::vec3 bounds_min = glm::vec3(0.0f);
+	glm::vec3 bounds_max = glm::vec3(0.0f);
+
+	// Bounding sphere around the bounds center, measured over the vertices at upload
+	glm::vec3 bounding_center = glm::vec3(0.0f);
+	float bounding_radius = 0.0f;
+
+	// Owns its GL objects, shared through MeshRegistry instead of copied
+	Mesh() = default;
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// Index size in bytes, either 2 or 4, set the bounds first when quantizing
+	// With an arena the mesh is copied into its shared buffers, which must outlive the mesh
+	unsigned char upload(const Vertex* vertices, size_t vertex_count, const void* indices, size_t index_count, unsigned int index_size, bool quantize = false, MeshArena* arena = nullptr);
+	unsigned char upload(const MeshData& mesh, bool quantize = false, MeshArena* arena = nullptr);
+
+	bool isUploaded() const { return vertex_array != 0; }
+	unsigned int getVertexArray() const { return vertex_array; }
+	MeshArena* getArena() const { return arena; }
+	unsigned int getIndexType() const { return index_type; }
+
+	// Shader side dequantization, position = position_offset + position * position_scale
+	bool isQuantized() const { return quantized; }
+	glm::vec3 getPositionOffset() const { return quantized ? bounds_min : glm::vec3(0.0f); }
+	glm::vec3 getPositionScale() const { return quantized ? bounds_max - bounds_min : glm::vec3(1.0f); }
+
+	// Index count of each level, stored one after the other, called after upload
+	void setLods(const unsigned int* counts, unsigned int count);
+	unsigned int getLodCount() const { return lod_count; }
+
+	// Meshlets of the first level, called after upload
+	void setMeshlets(const Meshlet* clusters, size_t count);
+	bool hasMeshlets() const { return !meshlets.empty(); }
+
+	// Bounding sphere and box moved by the model matrix, tested against the frustum
+	bool isVisible(const Frustum& frustum, const glm::mat4& model) const;
+
+	// Projected bounding sphere diameter as a fraction of the viewport height
+	float screenSize(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const;
+
+	// Level to draw for a screen size, hysteresis applied against the current level
+	unsigned int selectLod(float screen_size, unsigned int current_lod, const LodSettings& settings) const;
+
+	// Draws expect the vertex array to be bound, see RenderQueue
+	unsigned char draw(unsigned int lod = 0);
+	unsigned char drawInstanced(unsigned int lod, unsigned int instance_count);
+
+	// Draw the first level skipping culled meshlets in a single multi draw, counting both
+	unsigned char drawMeshlets(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, unsigned int& drawn, unsigned int& culled);
+
+	// Indirect commands drawing a level, the visible meshlet ranges for the first one, returns how many were added
+	size_t appendCommands(unsigned int lod, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, std::vector<DrawCommand>& commands, unsigned int& drawn, unsigned int& culled);
+
+	~Mesh();
+};
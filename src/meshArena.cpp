@@ -0,0 +1,155 @@
+#include "meshArena.hpp"
+#include "mesh.hpp"
+
+#include "glCalls.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+	// First fit, false when no range is large enough
+	bool allocateRange(std::vector<MeshArena::Range>& free, size_t count, size_t& offset) {
+		for(size_t i = 0; i < free.size(); i++) {
+			if(free[i].count < count)
+				continue;
+			offset = free[i].offset;
+			free[i].offset += count;
+			free[i].count -= count;
+			if(free[i].count == 0)
+				free.erase(free.begin() + i);
+			return true;
+		}
+		return false;
+	}
+
+	// Back into the sorted list, merged with the ranges right before and after it
+	void releaseRange(std::vector<MeshArena::Range>& free, size_t offset, size_t count) {
+		if(count == 0)
+			return;
+		std::vector<MeshArena::Range>::iterator range = std::lower_bound(free.begin(), free.end(), offset,
+			[](const MeshArena::Range& a, size_t b) { return a.offset < b; });
+		MeshArena::Range released = {offset, count};
+		range = free.insert(range, released);
+		if((range + 1 != free.end()) && (range->offset + range->count == (range + 1)->offset)) {
+			range->count += (range + 1)->count;
+			free.erase(range + 1);
+		}
+		if((range != free.begin()) && ((range - 1)->offset + (range - 1)->count == range->offset)) {
+			(range - 1)->count += range->count;
+			free.erase(range);
+		}
+	}
+
+	size_t freeCount(const std::vector<MeshArena::Range>& free) {
+		size_t count = 0;
+		for(const MeshArena::Range& range : free)
+			count += range.count;
+		return count;
+	}
+}
+
+MeshArena::MeshArena(size_t vertex_capacity, size_t index_capacity) {
+	for(IndexPool& index_pool : pools)
+		glGenVertexArrays(1, &index_pool.vertex_array);
+	grow(vertex_buffer, this->vertex_capacity, free_vertices, sizeof(Vertex), std::max<size_t>(vertex_capacity, 1));
+	IndexPool& short_pool = pool(sizeof(uint16_t));
+	grow(short_pool.buffer, short_pool.capacity, short_pool.free, sizeof(uint16_t), std::max<size_t>(index_capacity, 1));
+}
+
+void MeshArena::grow(unsigned int& buffer, size_t& capacity, std::vector<Range>& free, size_t element_size, size_t count) {
+	size_t new_capacity = std::max(capacity * 2, capacity + count);
+	unsigned int new_buffer;
+	glGenBuffers(1, &new_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_capacity * element_size, nullptr, GL_STATIC_DRAW);
+
+	// Copied on the GPU, the meshes keep their offsets
+	if(buffer) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * element_size);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	releaseRange(free, capacity, new_capacity - capacity);
+	buffer = new_buffer;
+	capacity = new_capacity;
+	setAttributes();
+}
+
+void MeshArena::setAttributes() {
+	// Same locations as the vertex arrays of meshes with buffers of their own
+	for(IndexPool& index_pool : pools) {
+		glBindVertexArray(index_pool.vertex_array);
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, position)));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, texture)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_pool.buffer);
+	}
+
+	// Unbind, the vertex arrays keep their index buffer binding
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+MeshAllocation MeshArena::add(const Vertex* vertices, size_t vertex_count, const void* indices, size_t index_count, unsigned int index_size) {
+	MeshAllocation allocation;
+	allocation.vertex_count = vertex_count;
+	allocation.index_count = index_count;
+	allocation.index_size = useShortIndices(vertex_count) ? sizeof(uint16_t) : sizeof(uint32_t);
+	if(!allocateRange(free_vertices, vertex_count, allocation.first_vertex)) {
+		grow(vertex_buffer, vertex_capacity, free_vertices, sizeof(Vertex), vertex_count);
+		allocateRange(free_vertices, vertex_count, allocation.first_vertex);
+	}
+	IndexPool& index_pool = pool(allocation.index_size);
+	if(!allocateRange(index_pool.free, index_count, allocation.first_index)) {
+		grow(index_pool.buffer, index_pool.capacity, index_pool.free, allocation.index_size, index_count);
+		allocateRange(index_pool.free, index_count, allocation.first_index);
+	}
+
+	// Converted only when given in the other size
+	std::vector<uint16_t> short_indices;
+	std::vector<uint32_t> long_indices;
+	if((index_size == sizeof(uint32_t)) && (allocation.index_size == sizeof(uint16_t))) {
+		short_indices.assign((const uint32_t*)indices, (const uint32_t*)indices + index_count);
+		indices = short_indices.data();
+	}
+	else if((index_size == sizeof(uint16_t)) && (allocation.index_size == sizeof(uint32_t))) {
+		long_indices.assign((const uint16_t*)indices, (const uint16_t*)indices + index_count);
+		indices = long_indices.data();
+	}
+
+	// Through the copy target, leaving the element buffer of any bound vertex array alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.first_vertex * sizeof(Vertex), vertex_count * sizeof(Vertex), vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, index_pool.buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.first_index * allocation.index_size, index_count * allocation.index_size, indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return allocation;
+}
+
+void MeshArena::release(const MeshAllocation& allocation) {
+	releaseRange(free_vertices, allocation.first_vertex, allocation.vertex_count);
+	IndexPool& index_pool = pool(allocation.index_size);
+	releaseRange(index_pool.free, allocation.first_index, allocation.index_count);
+}
+
+void MeshArena::printUsage() const {
+	const IndexPool& short_pool = pool(sizeof(uint16_t));
+	const IndexPool& long_pool = pool(sizeof(uint32_t));
+	std::cout << "Mesh arena: " << vertex_capacity - freeCount(free_vertices) << " of " << vertex_capacity << " vertices, "
+		<< short_pool.capacity - freeCount(short_pool.free) << " of " << short_pool.capacity << " 16 bit and "
+		<< long_pool.capacity - freeCount(long_pool.free) << " of " << long_pool.capacity << " 32 bit indices" << std::endl;
+}
+
+MeshArena::~MeshArena() {
+	for(IndexPool& index_pool : pools) {
+		glDeleteVertexArrays(1, &index_pool.vertex_array);
+		glDeleteBuffers(1, &index_pool.buffer);
+	}
+	glDeleteBuffers(1, &vertex_buffer);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct Vertex;
+
+// Layout of glMultiDrawElementsIndirect commands
+struct DrawCommand {
+	uint32_t count;
+	uint32_t instance_count;
+	uint32_t first_index;
+	uint32_t base_vertex;
+	uint32_t base_instance;
+};
+
+// Vertices and indices of one mesh inside the arena, in elements of their buffers
+struct MeshAllocation {
+	size_t first_vertex = 0;
+	size_t vertex_count = 0;
+	size_t first_index = 0;
+	size_t index_count = 0;
+	unsigned int index_size = 0;
+};
+
+// One vertex buffer, with a 16 and a 32 bit index buffer and a vertex array for each, the meshes of different shapes
+// are suballocated from
+// Meshes in the arena with the same index size share every piece of vertex state, so the draws of many of them go out
+// as one multi draw
+// Only the full Vertex layout is held, indices stay local to their mesh and are drawn with its first vertex as base,
+// 16 bit for meshes of up to 65536 vertices like with buffers of their own
+class MeshArena {
+public:
+	struct Range {
+		size_t offset;
+		size_t count;
+	};
+
+private:
+	struct IndexPool {
+		unsigned int vertex_array = 0;
+		unsigned int buffer = 0;
+		size_t capacity = 0;
+		std::vector<Range> free;
+	};
+
+	unsigned int vertex_buffer = 0;
+	size_t vertex_capacity = 0;
+	// Unused ranges sorted by offset, neighbours merged
+	std::vector<Range> free_vertices;
+
+	// 16 then 32 bit indices, the 32 bit buffer is only allocated once a large mesh needs it
+	IndexPool pools[2];
+
+	IndexPool& pool(unsigned int index_size) { return pools[(index_size == sizeof(uint16_t)) ? 0 : 1]; }
+	const IndexPool& pool(unsigned int index_size) const { return pools[(index_size == sizeof(uint16_t)) ? 0 : 1]; }
+
+	// Reallocate a buffer with at least count more elements, copying the old contents on the GPU
+	void grow(unsigned int& buffer, size_t& capacity, std::vector<Range>& free, size_t element_size, size_t count);
+	void setAttributes();
+
+public:
+	MeshArena(size_t vertex_capacity, size_t index_capacity);
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+
+	// Copy a mesh in, growing the buffers when it does not fit, index_size is either 2 or 4
+	// The indices are stored 16 bit whenever the vertex count allows it, whatever their size here
+	MeshAllocation add(const Vertex* vertices, size_t vertex_count, const void* indices, size_t index_count, unsigned int index_size);
+	void release(const MeshAllocation& allocation);
+
+	// Vertex array of the meshes with indices of that size
+	unsigned int getVertexArray(unsigned int index_size) const { return pool(index_size).vertex_array; }
+
+	// Print the used and allocated elements of both buffers
+	void printUsage() const;
+
+	~MeshArena();
+};
@@ -0,0 +1,314 @@
+#include "meshCache.hpp"
+#include "objParser.hpp"
+#include "meshImporter.hpp"
+#include "procedural.hpp"
+#include "meshlets.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+namespace {
+	size_t vertexOffset() {
+		return sizeof(bmesh::Header);
+	}
+
+	bool sameLodRatios(const bmesh::Header& header, const MeshSettings& settings) {
+		for(size_t i = 0; i < max_lods; i++) {
+			float ratio = (i < settings.lod_ratios.size()) ? settings.lod_ratios[i] : 0.0f;
+			if(header.lod_ratios[i] != ratio)
+				return false;
+		}
+		return true;
+	}
+
+	size_t indexOffset(const bmesh::Header& header) {
+		return vertexOffset() + (size_t)header.vertex_count * sizeof(Vertex);
+	}
+
+	size_t meshletOffset(const bmesh::Header& header) {
+		return (indexOffset(header) + (size_t)header.index_count * header.index_size + 3) & ~(size_t)3;
+	}
+
+	template<typename T>
+	bool indicesInRange(const T* indices, size_t count, uint32_t vertex_count) {
+		for(size_t i = 0; i < count; i++)
+			if(indices[i] >= vertex_count)
+				return false;
+		return true;
+	}
+
+	// Everything in the file stays inside its own arrays, the ranges go straight to the GPU
+	bool validContents(const bmesh::Header& header, const char* data) {
+		if(header.lod_count > max_lods)
+			return false;
+		uint64_t lod_total = 0;
+		for(uint32_t i = 0; i < header.lod_count; i++)
+			lod_total += header.lod_index_counts[i];
+		if(lod_total > header.index_count)
+			return false;
+
+		// Meshlets split the first level, the whole buffer without levels
+		uint64_t first_level = (header.lod_count > 0) ? header.lod_index_counts[0] : header.index_count;
+		const Meshlet* meshlets = (const Meshlet*)(data + meshletOffset(header));
+		for(uint32_t i = 0; i < header.meshlet_count; i++)
+			if((uint64_t)meshlets[i].index_offset + meshlets[i].index_count > first_level)
+				return false;
+
+		if(header.index_size == sizeof(uint16_t))
+			return indicesInRange((const uint16_t*)(data + indexOffset(header)), header.index_count, header.vertex_count);
+		return indicesInRange((const uint32_t*)(data + indexOffset(header)), header.index_count, header.vertex_count);
+	}
+}
+
+std::string bmesh::cachePath(std::string obj_file_path) {
+	size_t extension = obj_file_path.find_last_of('.');
+	size_t directory = obj_file_path.find_last_of('/');
+	if((extension == std::string::npos) || ((directory != std::string::npos) && (extension < directory)) || importer::handles(obj_file_path))
+		return obj_file_path + ".bmesh";
+	return obj_file_path.substr(0, extension) + ".bmesh";
+}
+
+uint32_t bmesh::settingsFlags(const MeshSettings& settings) {
+	uint32_t flags = 0;
+	if(settings.optimize)
+		flags |= OPTIMIZED;
+	if(settings.optimize && settings.optimize_overdraw)
+		flags |= OPTIMIZED_OVERDRAW;
+	if(settings.meshlets)
+		flags |= MESHLETS;
+	return flags;
+}
+
+bool bmesh::open(std::string obj_file_path, MappedFile& cache_file, const MeshSettings& settings) {
+	SourceInfo source;
+	if(!getSourceInfo(obj_file_path, source))
+		return false;
+	std::string cache_path = cachePath(obj_file_path);
+	SourceInfo cache;
+	if(!getSourceInfo(cache_path, cache) || (cache.size < sizeof(Header)))
+		return false;
+
+	try {
+		cache_file.open(cache_path);
+	}
+	catch(const std::runtime_error&) {
+		return false;
+	}
+
+	const Header* header = (const Header*)cache_file.data();
+	if((memcmp(header->magic, magic, sizeof(magic)) != 0) || (header->version != version) || (header->flags != settingsFlags(settings)) || !sameLodRatios(*header, settings) ||
+		((header->index_size != 2) && (header->index_size != 4)) ||
+		(cache_file.size() != meshletOffset(*header) + (size_t)header->meshlet_count * sizeof(Meshlet)) || !validContents(*header, cache_file.data())) {
+		cache_file.close();
+		return false;
+	}
+
+	// Same size and time means the same source, otherwise fall back to comparing contents
+	if(header->source_size != source.size) {
+		cache_file.close();
+		return false;
+	}
+	if(header->source_mtime != source.mtime) {
+		if(header->source_hash != hashFile(obj_file_path)) {
+			cache_file.close();
+			return false;
+		}
+		// Only touched, store the new time so the next launch skips hashing
+		std::fstream cache_stream(cache_path, std::fstream::binary | std::fstream::in | std::fstream::out);
+		cache_stream.seekp(offsetof(Header, source_mtime));
+		cache_stream.write((const char*)&source.mtime, sizeof(source.mtime));
+	}
+
+	return true;
+}
+
+bool bmesh::write(std::string obj_file_path, const MeshData& mesh, const MeshSettings& settings) {
+	SourceInfo source;
+	if(!getSourceInfo(obj_file_path, source))
+		return false;
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.flags = settingsFlags(settings);
+	for(size_t i = 0; (i < settings.lod_ratios.size()) && (i < max_lods); i++)
+		header.lod_ratios[i] = settings.lod_ratios[i];
+	header.lod_count = std::min<size_t>(mesh.lod_counts.size(), max_lods);
+	for(uint32_t i = 0; i < header.lod_count; i++)
+		header.lod_index_counts[i] = mesh.lod_counts[i];
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.source_hash = hashFile(obj_file_path);
+	header.vertex_count = mesh.vertices.size();
+	header.index_count = mesh.indices.size();
+	header.index_size = useShortIndices(mesh.vertices.size()) ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.meshlet_count = mesh.meshlets.size();
+	for(unsigned char i = 0; i < 3; i++) {
+		header.bounds_min[i] = mesh.bounds_min[i];
+		header.bounds_max[i] = mesh.bounds_max[i];
+	}
+
+	// Write to a temporary file of this thread and rename, so neither a crash nor another writer leaves a truncated cache behind
+	std::string cache_path = cachePath(obj_file_path);
+	std::string temp_path = temporaryPath(cache_path);
+	std::ofstream cache_stream(temp_path, std::ofstream::binary | std::ofstream::trunc);
+	if(!cache_stream.good())
+		return false;
+	cache_stream.write((const char*)&header, sizeof(header));
+	cache_stream.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+	if(header.index_size == sizeof(uint16_t)) {
+		std::vector<uint16_t> short_indices(mesh.indices.begin(), mesh.indices.end());
+		cache_stream.write((const char*)short_indices.data(), short_indices.size() * sizeof(uint16_t));
+	}
+	else
+		cache_stream.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+	const char padding[4] = {0};
+	cache_stream.write(padding, meshletOffset(header) - indexOffset(header) - (size_t)header.index_count * header.index_size);
+	cache_stream.write((const char*)mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+	cache_stream.close();
+	if(!cache_stream.good() || (rename(temp_path.c_str(), cache_path.c_str()) != 0)) {
+		remove(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+namespace {
+	void buildMeshlets(std::string name, MeshData& mesh_data) {
+		meshlets::buildMeshlets(mesh_data);
+		if(mesh_data.meshlets.empty())
+			return;
+		size_t triangles = 0;
+		unsigned int cone_count = 0;
+		for(size_t i = 0; i < mesh_data.meshlets.size(); i++) {
+			triangles += mesh_data.meshlets[i].index_count / 3;
+			cone_count += (mesh_data.meshlets[i].cone_cutoff <= 1.0f);
+		}
+		std::cout << "Mesh " << name << ": " << mesh_data.meshlets.size() << " meshlets, " << (float)triangles / mesh_data.meshlets.size()
+			<< " triangles each, " << cone_count << " can be back face culled" << std::endl;
+	}
+
+	// Parse the obj (or import other formats), build levels of detail and optimize as configured, then refresh the cache
+	void buildMesh(std::string obj_file_path, MeshData& mesh_data, const MeshSettings& settings) {
+		if(importer::handles(obj_file_path))
+			importer::load(obj_file_path, mesh_data);
+		else
+			obj::load(obj_file_path, mesh_data, settings.pool);
+		printMeshSize(obj_file_path, mesh_data);
+		if(settings.lod_ratios.size() > 1) {
+			simplify::buildLods(mesh_data, settings.lod_ratios);
+			std::cout << "Mesh " << obj_file_path << ": " << mesh_data.lod_counts.size() << " levels of detail,";
+			for(size_t i = 0; i < mesh_data.lod_counts.size(); i++)
+				std::cout << " " << mesh_data.lod_counts[i] / 3;
+			std::cout << " triangles" << std::endl;
+		}
+		if(settings.optimize)
+			optimize::optimizeMesh(obj_file_path, mesh_data, settings.optimize_overdraw);
+		if(settings.meshlets)
+			buildMeshlets(obj_file_path, mesh_data);
+		if(!bmesh::write(obj_file_path, mesh_data, settings))
+			std::cout << "Mesh " << obj_file_path << ": could not write " << bmesh::cachePath(obj_file_path) << std::endl;
+		if(settings.quantize)
+			std::cout << "Mesh " << obj_file_path << ": quantized vertex buffer " << mesh_data.vertices.size() * sizeof(Vertex) << " -> " << mesh_data.vertices.size() * sizeof(PackedVertex) << " bytes" << std::endl;
+	}
+
+	// Generated meshes are not cached, their levels of detail are tessellated directly instead of simplified
+	void generateMesh(std::string name, MeshData& mesh_data, const MeshSettings& settings) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		procedural::load(name, mesh_data, settings.lod_ratios);
+		if(settings.optimize)
+			optimize::optimizeMesh(name, mesh_data, settings.optimize_overdraw);
+		if(settings.meshlets)
+			buildMeshlets(name, mesh_data);
+
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Mesh " << name << ": " << mesh_data.vertices.size() << " vertices, " << (mesh_data.lod_counts.empty() ? mesh_data.indices.size() : mesh_data.lod_counts[0]) / 3
+			<< " triangles generated in " << span.count() << " ms" << std::endl;
+	}
+}
+
+unsigned char bmesh::read(std::string obj_file_path, MeshData& mesh_data, const MeshSettings& settings) {
+	if(procedural::handles(obj_file_path)) {
+		generateMesh(obj_file_path, mesh_data, settings);
+		return 0;
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	MappedFile cache_file;
+	if(open(obj_file_path, cache_file, settings)) {
+		const Header* header = (const Header*)cache_file.data();
+		mesh_data.bounds_min = glm::vec3(header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]);
+		mesh_data.bounds_max = glm::vec3(header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]);
+		const Vertex* vertices = (const Vertex*)(cache_file.data() + vertexOffset());
+		mesh_data.vertices.assign(vertices, vertices + header->vertex_count);
+		if(header->index_size == sizeof(uint16_t)) {
+			const uint16_t* indices = (const uint16_t*)(cache_file.data() + indexOffset(*header));
+			mesh_data.indices.assign(indices, indices + header->index_count);
+		}
+		else {
+			const uint32_t* indices = (const uint32_t*)(cache_file.data() + indexOffset(*header));
+			mesh_data.indices.assign(indices, indices + header->index_count);
+		}
+		mesh_data.lod_counts.assign(header->lod_index_counts, header->lod_index_counts + header->lod_count);
+		const Meshlet* meshlets = (const Meshlet*)(cache_file.data() + meshletOffset(*header));
+		mesh_data.meshlets.assign(meshlets, meshlets + header->meshlet_count);
+
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Mesh " << obj_file_path << ": read from " << cachePath(obj_file_path) << " in " << span.count() << " ms" << std::endl;
+		return 0;
+	}
+
+	buildMesh(obj_file_path, mesh_data, settings);
+
+	std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Mesh " << obj_file_path << ": parsed in " << span.count() << " ms" << std::endl;
+	return 0;
+}
+
+unsigned char bmesh::load(std::string obj_file_path, Mesh& mesh, const MeshSettings& settings) {
+	if(procedural::handles(obj_file_path)) {
+		MeshData mesh_data;
+		generateMesh(obj_file_path, mesh_data, settings);
+		mesh.upload(mesh_data, settings.quantize, settings.arena);
+		return 0;
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	MappedFile cache_file;
+	if(open(obj_file_path, cache_file, settings)) {
+		// Straight from the mapping to the GPU
+		const Header* header = (const Header*)cache_file.data();
+		mesh.bounds_min = glm::vec3(header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]);
+		mesh.bounds_max = glm::vec3(header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]);
+		mesh.upload((const Vertex*)(cache_file.data() + vertexOffset()), header->vertex_count,
+			cache_file.data() + indexOffset(*header), header->index_count, header->index_size, settings.quantize, settings.arena);
+		if(header->lod_count > 0)
+			mesh.setLods(header->lod_index_counts, header->lod_count);
+		if(header->meshlet_count > 0)
+			mesh.setMeshlets((const Meshlet*)(cache_file.data() + meshletOffset(*header)), header->meshlet_count);
+
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Mesh " << obj_file_path << ": loaded from " << cachePath(obj_file_path) << " in " << span.count() << " ms" << std::endl;
+		return 0;
+	}
+
+	MeshData mesh_data;
+	buildMesh(obj_file_path, mesh_data, settings);
+	mesh.upload(mesh_data, settings.quantize, settings.arena);
+
+	std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Mesh " << obj_file_path << ": parsed in " << span.count() << " ms" << std::endl;
+	return 0;
+}
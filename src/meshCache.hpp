@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+
+#include "mesh.hpp"
+#include "mappedFile.hpp"
+
+// Binary mesh cache, stored next to the source obj (or imported file) with the .bmesh extension
+// Layout: Header, Vertex array, index array (16 or 32 bit) holding every level of detail,
+// padded to 4 bytes and followed by the Meshlet array of the first level
+namespace bmesh {
+	const char magic[4] = {'B', 'M', 'S', 'H'};
+	const uint32_t version = 4;
+
+	// Processing applied to the cached mesh, a cache built with other settings is rebuilt
+	enum flags {
+		OPTIMIZED = 1 << 0,
+		OPTIMIZED_OVERDRAW = 1 << 1,
+		MESHLETS = 1 << 2
+	};
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t source_size;
+		int64_t source_mtime;
+		uint64_t source_hash;
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t index_size;
+		float bounds_min[3];
+		float bounds_max[3];
+		uint32_t flags;
+		uint32_t lod_count;
+		uint32_t lod_index_counts[max_lods];
+		float lod_ratios[max_lods];
+		uint32_t meshlet_count;
+	};
+
+	// earth.obj -> earth.bmesh, other formats keep their extension: earth.glb -> earth.glb.bmesh
+	std::string cachePath(std::string obj_file_path);
+
+	// Flags matching the processing enabled in the settings
+	uint32_t settingsFlags(const MeshSettings& settings);
+
+	// Map the cache of an obj, false if missing, corrupt (ranges or indices outside their arrays included), older than
+	// the source or built with other settings
+	bool open(std::string obj_file_path, MappedFile& cache_file, const MeshSettings& settings = MeshSettings());
+
+	// Write the cache of an obj, false if the directory is not writable
+	bool write(std::string obj_file_path, const MeshData& mesh, const MeshSettings& settings = MeshSettings());
+
+	// Read a mesh from its cache when valid, otherwise parse the obj and refresh the cache
+	// Does not touch OpenGL, safe to call from worker threads
+	unsigned char read(std::string obj_file_path, MeshData& mesh, const MeshSettings& settings = MeshSettings());
+
+	// Upload a mesh from its cache when valid, otherwise parse the obj and refresh the cache
+	// Procedural meshes (procedural:...) are generated instead
+	unsigned char load(std::string obj_file_path, Mesh& mesh, const MeshSettings& settings = MeshSettings());
+}
@@ -0,0 +1,78 @@
+#include "meshImporter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef BERGIMUS_ASSIMP
+#include <assimp/config.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#endif
+
+bool importer::available() {
+#ifdef BERGIMUS_ASSIMP
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool importer::handles(std::string file_path) {
+	size_t extension = file_path.find_last_of('.');
+	if(extension == std::string::npos)
+		return false;
+	std::string suffix = file_path.substr(extension);
+	std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+	return suffix.compare(".obj") != 0;
+}
+
+unsigned char importer::load(std::string file_path, MeshData& mesh) {
+#ifdef BERGIMUS_ASSIMP
+	// Welded triangles with normals, node transforms baked in so the scene becomes a single mesh
+	// UVs are already bottom-up in assimp, as in obj files
+	Assimp::Importer scene_importer;
+	scene_importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+	const aiScene* scene = scene_importer.ReadFile(file_path, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices |
+		aiProcess_GenSmoothNormals | aiProcess_PreTransformVertices);
+	if(!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+		throw std::runtime_error(std::string("Failed to import mesh file: ")+file_path+std::string(", ")+scene_importer.GetErrorString());
+		return -1;
+	}
+
+	size_t vertex_count = 0;
+	size_t index_count = 0;
+	for(unsigned int i = 0; i < scene->mNumMeshes; i++) {
+		vertex_count += scene->mMeshes[i]->mNumVertices;
+		index_count += (size_t)scene->mMeshes[i]->mNumFaces * 3;
+	}
+	mesh.vertices.reserve(vertex_count);
+	mesh.indices.reserve(index_count);
+
+	for(unsigned int i = 0; i < scene->mNumMeshes; i++) {
+		const aiMesh* scene_mesh = scene->mMeshes[i];
+		unsigned int base = mesh.vertices.size();
+		for(unsigned int v = 0; v < scene_mesh->mNumVertices; v++) {
+			Vertex vertex;
+			vertex.position = glm::vec3(scene_mesh->mVertices[v].x, scene_mesh->mVertices[v].y, scene_mesh->mVertices[v].z);
+			vertex.texture = scene_mesh->HasTextureCoords(0) ? glm::vec2(scene_mesh->mTextureCoords[0][v].x, scene_mesh->mTextureCoords[0][v].y) : glm::vec2(0.0f);
+			vertex.normal = scene_mesh->HasNormals() ? glm::vec3(scene_mesh->mNormals[v].x, scene_mesh->mNormals[v].y, scene_mesh->mNormals[v].z) : glm::vec3(0.0f);
+			mesh.vertices.push_back(vertex);
+		}
+		for(unsigned int f = 0; f < scene_mesh->mNumFaces; f++) {
+			// Sorted by primitive type, anything left is a triangle
+			if(scene_mesh->mFaces[f].mNumIndices != 3)
+				continue;
+			for(unsigned int c = 0; c < 3; c++)
+				mesh.indices.push_back(base + scene_mesh->mFaces[f].mIndices[c]);
+		}
+	}
+	computeBounds(mesh);
+
+	return 0;
+#else
+	(void)mesh;
+	throw std::runtime_error(std::string("Built without assimp, cannot import: ")+file_path);
+	return -1;
+#endif
+}
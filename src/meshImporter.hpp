@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+#include "mesh.hpp"
+
+// Meshes in other formats than obj (glTF/GLB, FBX, ...) read through assimp
+// Only available when built with BERGIMUS_ASSIMP, obj files always use the obj parser
+namespace importer {
+	// Built with assimp
+	bool available();
+
+	// Any file not ending in .obj goes through the importer
+	bool handles(std::string file_path);
+
+	// Read every mesh of the scene, flattened with its node transforms, into a mesh ready to upload
+	unsigned char load(std::string file_path, MeshData& mesh);
+}
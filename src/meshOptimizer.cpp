@@ -0,0 +1,243 @@
+#include "meshOptimizer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+
+namespace {
+	// Simulated FIFO cache, counts the vertices that had to be transformed
+	size_t countTransforms(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size) {
+		std::vector<size_t> timestamps(vertex_count, 0);
+		size_t time = cache_size + 1;
+		size_t transforms = 0;
+		for(size_t i = 0; i < indices.size(); i++) {
+			unsigned int v = indices[i];
+			if(time - timestamps[v] > cache_size) {
+				timestamps[v] = time;
+				time++;
+				transforms++;
+			}
+		}
+		return transforms;
+	}
+
+	int skipDeadEnd(std::vector<unsigned int>& dead_end, const std::vector<unsigned int>& live, size_t& cursor, size_t vertex_count) {
+		// Recently used vertices first
+		while(!dead_end.empty()) {
+			unsigned int v = dead_end.back();
+			dead_end.pop_back();
+			if(live[v] > 0)
+				return v;
+		}
+		// Then the next vertex in input order
+		while(cursor < vertex_count) {
+			if(live[cursor] > 0)
+				return cursor++;
+			cursor++;
+		}
+		return -1;
+	}
+}
+
+float optimize::computeAcmr(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size) {
+	if(indices.empty())
+		return 0.0f;
+	return (float)countTransforms(indices, vertex_count, cache_size) / (indices.size() / 3);
+}
+
+float optimize::computeAtvr(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size) {
+	if(vertex_count == 0)
+		return 0.0f;
+	return (float)countTransforms(indices, vertex_count, cache_size) / vertex_count;
+}
+
+void optimize::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size, std::vector<size_t>* cluster_starts) {
+	size_t triangle_count = indices.size() / 3;
+	if(triangle_count == 0)
+		return;
+
+	// Triangles using each vertex, as offsets into one flat list
+	std::vector<unsigned int> live(vertex_count, 0);
+	for(size_t i = 0; i < triangle_count * 3; i++)
+		live[indices[i]]++;
+	std::vector<size_t> adjacency_offset(vertex_count + 1, 0);
+	for(size_t v = 0; v < vertex_count; v++)
+		adjacency_offset[v + 1] = adjacency_offset[v] + live[v];
+	std::vector<unsigned int> adjacency(adjacency_offset[vertex_count]);
+	std::vector<size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+	for(size_t t = 0; t < triangle_count; t++) {
+		for(unsigned char c = 0; c < 3; c++)
+			adjacency[fill[indices[t * 3 + c]]++] = t;
+	}
+
+	std::vector<size_t> timestamps(vertex_count, 0);
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<unsigned int> dead_end;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(triangle_count * 3);
+
+	size_t time = cache_size + 1;
+	size_t cursor = 1;
+	int fanning = indices[0];
+	if(cluster_starts)
+		cluster_starts->push_back(0);
+	while(fanning >= 0) {
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for(size_t a = adjacency_offset[fanning]; a < adjacency_offset[fanning + 1]; a++) {
+			unsigned int t = adjacency[a];
+			if(emitted[t])
+				continue;
+			for(unsigned char c = 0; c < 3; c++) {
+				unsigned int v = indices[t * 3 + c];
+				output.push_back(v);
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if(time - timestamps[v] > cache_size) {
+					timestamps[v] = time;
+					time++;
+				}
+			}
+			emitted[t] = true;
+		}
+
+		// Next fanning vertex, the candidate staying longest in cache without being evicted
+		int best = -1;
+		long best_priority = -1;
+		for(size_t i = 0; i < candidates.size(); i++) {
+			unsigned int v = candidates[i];
+			if(live[v] == 0)
+				continue;
+			long priority = 0;
+			if(time - timestamps[v] + 2 * live[v] <= cache_size)
+				priority = time - timestamps[v];
+			if(priority > best_priority) {
+				best_priority = priority;
+				best = v;
+			}
+		}
+		if(best < 0) {
+			best = skipDeadEnd(dead_end, live, cursor, vertex_count);
+			if((best >= 0) && cluster_starts && (output.size() < triangle_count * 3))
+				cluster_starts->push_back(output.size());
+		}
+		fanning = best;
+	}
+
+	indices.swap(output);
+}
+
+void optimize::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& cluster_starts) {
+	if(cluster_starts.size() < 2)
+		return;
+
+	// Area weighted mesh center
+	glm::vec3 mesh_center(0.0f);
+	float mesh_area = 0.0f;
+	for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+		glm::vec3 a = vertices[indices[i]].position;
+		glm::vec3 b = vertices[indices[i + 1]].position;
+		glm::vec3 c = vertices[indices[i + 2]].position;
+		float area = glm::length(glm::cross(b - a, c - a));
+		mesh_center += area * (a + b + c) / 3.0f;
+		mesh_area += area;
+	}
+	if(mesh_area > 0.0f)
+		mesh_center /= mesh_area;
+
+	// Occlusion potential of each cluster, how much it faces away from the center
+	struct Cluster {
+		size_t begin;
+		size_t end;
+		float potential;
+	};
+	std::vector<Cluster> clusters;
+	for(size_t i = 0; i < cluster_starts.size(); i++) {
+		Cluster cluster;
+		cluster.begin = cluster_starts[i];
+		cluster.end = (i + 1 < cluster_starts.size()) ? cluster_starts[i + 1] : indices.size();
+		glm::vec3 center(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for(size_t j = cluster.begin; j + 2 < cluster.end; j += 3) {
+			glm::vec3 a = vertices[indices[j]].position;
+			glm::vec3 b = vertices[indices[j + 1]].position;
+			glm::vec3 c = vertices[indices[j + 2]].position;
+			glm::vec3 face_normal = glm::cross(b - a, c - a);
+			float face_area = glm::length(face_normal);
+			center += face_area * (a + b + c) / 3.0f;
+			normal += face_normal;
+			area += face_area;
+		}
+		if(area > 0.0f)
+			center /= area;
+		float normal_length = glm::length(normal);
+		cluster.potential = (normal_length > 0.0f) ? glm::dot(center - mesh_center, normal / normal_length) : 0.0f;
+		clusters.push_back(cluster);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.potential > b.potential;
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for(size_t i = 0; i < clusters.size(); i++)
+		output.insert(output.end(), indices.begin() + clusters[i].begin, indices.begin() + clusters[i].end);
+	indices.swap(output);
+}
+
+void optimize::optimizeVertexFetch(MeshData& mesh) {
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+	std::vector<Vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+	for(size_t i = 0; i < mesh.indices.size(); i++) {
+		unsigned int& target = remap[mesh.indices[i]];
+		if(target == unused) {
+			target = vertices.size();
+			vertices.push_back(mesh.vertices[mesh.indices[i]]);
+		}
+		mesh.indices[i] = target;
+	}
+	mesh.vertices.swap(vertices);
+}
+
+void optimize::optimizeMesh(std::string name, MeshData& mesh, bool overdraw) {
+	// Each level of detail is a separate range of the index array
+	std::vector<unsigned int> lod_counts = mesh.lod_counts;
+	if(lod_counts.empty())
+		lod_counts.push_back(mesh.indices.size());
+
+	size_t offset = 0;
+	std::vector<float> acmr_before, atvr_before;
+	std::vector<size_t> cluster_counts;
+	for(size_t lod = 0; lod < lod_counts.size(); lod++) {
+		std::vector<unsigned int> range(mesh.indices.begin() + offset, mesh.indices.begin() + offset + lod_counts[lod]);
+		acmr_before.push_back(computeAcmr(range, mesh.vertices.size()));
+		atvr_before.push_back(computeAtvr(range, mesh.vertices.size()));
+
+		std::vector<size_t> cluster_starts;
+		optimizeVertexCache(range, mesh.vertices.size(), cache_size, &cluster_starts);
+		if(overdraw)
+			optimizeOverdraw(range, mesh.vertices, cluster_starts);
+		cluster_counts.push_back(cluster_starts.size());
+		std::copy(range.begin(), range.end(), mesh.indices.begin() + offset);
+		offset += lod_counts[lod];
+	}
+	optimizeVertexFetch(mesh);
+
+	offset = 0;
+	for(size_t lod = 0; lod < lod_counts.size(); lod++) {
+		std::vector<unsigned int> range(mesh.indices.begin() + offset, mesh.indices.begin() + offset + lod_counts[lod]);
+		std::cout << "Mesh " << name;
+		if(lod_counts.size() > 1)
+			std::cout << " LOD " << lod;
+		std::cout << ": ACMR " << acmr_before[lod] << " -> " << computeAcmr(range, mesh.vertices.size())
+			<< ", ATVR " << atvr_before[lod] << " -> " << computeAtvr(range, mesh.vertices.size())
+			<< " (" << cache_size << " entry FIFO, " << cluster_counts[lod] << " clusters)" << std::endl;
+		offset += lod_counts[lod];
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+
+// Triangle and vertex reordering for the post transform cache, vertex fetch and overdraw
+namespace optimize {
+	// FIFO cache size assumed by the reordering and the metrics
+	const unsigned int cache_size = 16;
+
+	// Average cache miss ratio, transformed vertices per triangle (0.5 best, 3 worst)
+	float computeAcmr(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size = optimize::cache_size);
+
+	// Average transformed to vertex ratio, transformed vertices per vertex (1 best)
+	float computeAtvr(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size = optimize::cache_size);
+
+	// Tipsify (Sander et al. 2007) triangle order, the index of each new cluster start is appended to cluster_starts
+	void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size = optimize::cache_size, std::vector<size_t>* cluster_starts = nullptr);
+
+	// Sort the clusters so triangles facing out from the mesh center are drawn first
+	void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& cluster_starts);
+
+	// Renumber vertices in the order they are first used, unused vertices are dropped
+	void optimizeVertexFetch(MeshData& mesh);
+
+	// Run every stage enabled in the settings and print the metrics before and after
+	void optimizeMesh(std::string name, MeshData& mesh, bool overdraw);
+}
@@ -0,0 +1,73 @@
+#include "meshRegistry.hpp"
+#include "meshCache.hpp"
+#include "assetLoader.hpp"
+#include "mappedFile.hpp"
+
+#include <iostream>
+
+namespace {
+	const char square_key[] = "<square>";
+
+	void uploadSquare(Mesh& mesh) {
+		MeshData mesh_data;
+		Vertex v1;
+		v1.position = glm::vec3{0.5f, 0.5f, 0.0f};
+		v1.texture = glm::vec2{1.0f, 1.0f};
+		Vertex v2;
+		v2.position = glm::vec3{0.5f, -0.5f, 0.0f};
+		v2.texture = glm::vec2{1.0f, 0.0f};
+		Vertex v3;
+		v3.position = glm::vec3{-0.5f, -0.5f, 0.0f};
+		v3.texture = glm::vec2{0.0f, 0.0f};
+		Vertex v4;
+		v4.position = glm::vec3{-0.5f, 0.5f, 0.0f};
+		v4.texture = glm::vec2{0.0f, 1.0f};
+		mesh_data.vertices.push_back(v1);
+		mesh_data.vertices.push_back(v2);
+		mesh_data.vertices.push_back(v3);
+		mesh_data.vertices.push_back(v4);
+		mesh_data.indices = {	0,	1,	3,
+								1,	2,	3};
+		computeBounds(mesh_data);
+
+		// Send data to the GPU
+		mesh.upload(mesh_data);
+	}
+}
+
+std::shared_ptr<Mesh> MeshRegistry::acquire(std::string obj_file_path, const MeshSettings& settings, AssetLoader* loader) {
+	std::string key = obj_file_path.empty() ? std::string(square_key) : canonicalPath(obj_file_path);
+
+	std::shared_ptr<Mesh> mesh = meshes[key].lock();
+	if(mesh)
+		return mesh;
+
+	mesh = std::make_shared<Mesh>();
+	if(obj_file_path.empty())
+		uploadSquare(*mesh);
+	else if(loader)
+		loader->loadMesh(obj_file_path, mesh, settings);
+	else
+		bmesh::load(obj_file_path, *mesh, settings);
+	meshes[key] = mesh;
+	return mesh;
+}
+
+size_t MeshRegistry::size() {
+	size_t alive = 0;
+	for(auto it = meshes.begin(); it != meshes.end();) {
+		if(it->second.expired())
+			it = meshes.erase(it);
+		else {
+			alive++;
+			it++;
+		}
+	}
+	return alive;
+}
+
+void MeshRegistry::printUsage() {
+	std::cout << "Meshes loaded: " << size() << std::endl;
+	for(auto& entry : meshes)
+		std::cout << "\t" << entry.first << ": " << entry.second.use_count() << " users" << std::endl;
+}
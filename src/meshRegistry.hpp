@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "mesh.hpp"
+
+class AssetLoader;
+
+// Meshes shared between every object and light using the same obj file, keyed by canonical path
+// A mesh is loaded and uploaded on its first use and released with its last user
+class MeshRegistry {
+private:
+	std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
+
+public:
+	MeshRegistry() = default;
+	MeshRegistry(const MeshRegistry&) = delete;
+	MeshRegistry& operator=(const MeshRegistry&) = delete;
+
+	// Shared mesh of an obj file, an empty path gives the unit square
+	// With a loader the mesh is returned right away and uploaded once loaded in the background
+	std::shared_ptr<Mesh> acquire(std::string obj_file_path, const MeshSettings& settings = MeshSettings(), AssetLoader* loader = nullptr);
+
+	// Meshes currently alive
+	size_t size();
+
+	// Print every alive mesh with its number of users
+	void printUsage();
+};
@@ -0,0 +1,279 @@
+#include "meshSimplifier.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdint.h>
+
+namespace {
+	// Symmetric 4x4 error quadric, upper triangle only
+	struct Quadric {
+		double a[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+		void addPlane(glm::dvec3 n, double d, double weight) {
+			a[0] += weight * n.x * n.x; a[1] += weight * n.x * n.y; a[2] += weight * n.x * n.z; a[3] += weight * n.x * d;
+			a[4] += weight * n.y * n.y; a[5] += weight * n.y * n.z; a[6] += weight * n.y * d;
+			a[7] += weight * n.z * n.z; a[8] += weight * n.z * d;
+			a[9] += weight * d * d;
+		}
+
+		void add(const Quadric& q) {
+			for(unsigned char i = 0; i < 10; i++)
+				a[i] += q.a[i];
+		}
+
+		double error(glm::dvec3 p) const {
+			return a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x
+				+ a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y
+				+ a[7] * p.z * p.z + 2 * a[8] * p.z
+				+ a[9];
+		}
+	};
+
+	struct Collapse {
+		unsigned int from;
+		unsigned int to;
+		double cost;
+	};
+
+	bool lessPosition(const glm::vec3& a, const glm::vec3& b) {
+		if(a.x != b.x)
+			return a.x < b.x;
+		if(a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	}
+
+	bool lessVertex(const Vertex& a, const Vertex& b) {
+		if(a.position != b.position)
+			return lessPosition(a.position, b.position);
+		if(a.texture.x != b.texture.x)
+			return a.texture.x < b.texture.x;
+		return a.texture.y < b.texture.y;
+	}
+
+	typedef std::map<glm::vec3, unsigned int, bool(*)(const glm::vec3&, const glm::vec3&)> PositionMap;
+	typedef std::map<Vertex, unsigned int, bool(*)(const Vertex&, const Vertex&)> VertexMap;
+
+	// Vertices that must not move, on open borders or sharing a position with another used vertex (seams)
+	std::vector<bool> findLockedVertices(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+		std::vector<bool> locked(vertices.size(), false);
+
+		std::vector<bool> used(vertices.size(), false);
+		for(size_t i = 0; i < indices.size(); i++)
+			used[indices[i]] = true;
+		PositionMap first_at_position(lessPosition);
+		for(size_t v = 0; v < vertices.size(); v++) {
+			if(!used[v])
+				continue;
+			std::pair<PositionMap::iterator, bool> inserted = first_at_position.insert(std::make_pair(vertices[v].position, (unsigned int)v));
+			if(!inserted.second) {
+				locked[v] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+
+		// Directed edges without their opposite are on a border
+		std::map<uint64_t, int> edges;
+		for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+			for(unsigned char c = 0; c < 3; c++) {
+				uint64_t a = indices[i + c], b = indices[i + (c + 1) % 3];
+				edges[(a << 32) | b]++;
+			}
+		}
+		for(std::map<uint64_t, int>::iterator edge = edges.begin(); edge != edges.end(); edge++) {
+			uint64_t a = edge->first >> 32, b = edge->first & 0xFFFFFFFF;
+			if(edges.find((b << 32) | a) == edges.end()) {
+				locked[a] = true;
+				locked[b] = true;
+			}
+		}
+		return locked;
+	}
+
+	unsigned int resolve(std::vector<unsigned int>& remap, unsigned int v) {
+		while(remap[v] != v) {
+			remap[v] = remap[remap[v]];
+			v = remap[v];
+		}
+		return v;
+	}
+}
+
+void simplify::simplifyIndices(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t target_index_count, std::vector<unsigned int>& output) {
+	output = indices;
+	if(output.size() <= target_index_count)
+		return;
+
+	std::vector<bool> locked = findLockedVertices(vertices, indices);
+
+	// Area weighted plane quadrics of the faces around each vertex
+	std::vector<Quadric> quadrics(vertices.size());
+	for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+		glm::dvec3 a(vertices[indices[i]].position), b(vertices[indices[i + 1]].position), c(vertices[indices[i + 2]].position);
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double area = glm::length(normal);
+		if(area <= 0.0)
+			continue;
+		normal /= area;
+		for(unsigned char j = 0; j < 3; j++)
+			quadrics[indices[i + j]].addPlane(normal, -glm::dot(normal, a), area);
+	}
+
+	std::vector<unsigned int> remap(vertices.size());
+	for(size_t v = 0; v < vertices.size(); v++)
+		remap[v] = v;
+
+	std::vector<size_t> adjacency_offset;
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched;
+
+	while(output.size() > target_index_count) {
+		// Triangles around each vertex
+		adjacency_offset.assign(vertices.size() + 1, 0);
+		for(size_t i = 0; i < output.size(); i++)
+			adjacency_offset[output[i] + 1]++;
+		for(size_t v = 0; v < vertices.size(); v++)
+			adjacency_offset[v + 1] += adjacency_offset[v];
+		adjacency.resize(output.size());
+		std::vector<size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for(size_t i = 0; i < output.size(); i++)
+			adjacency[fill[output[i]]++] = i / 3;
+
+		// Every edge in both directions, cheapest first
+		collapses.clear();
+		for(size_t i = 0; i < output.size(); i += 3) {
+			for(unsigned char c = 0; c < 3; c++) {
+				unsigned int a = output[i + c], b = output[i + (c + 1) % 3];
+				for(unsigned char direction = 0; direction < 2; direction++) {
+					Collapse collapse;
+					collapse.from = direction ? b : a;
+					collapse.to = direction ? a : b;
+					if(locked[collapse.from])
+						continue;
+					Quadric merged = quadrics[collapse.from];
+					merged.add(quadrics[collapse.to]);
+					collapse.cost = merged.error(glm::dvec3(vertices[collapse.to].position));
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.cost < b.cost;
+		});
+
+		// Independent collapses, no vertex of a changed triangle moves twice in one pass
+		touched.assign(vertices.size(), false);
+		size_t remaining = output.size();
+		size_t collapsed = 0;
+		for(size_t i = 0; (i < collapses.size()) && (remaining > target_index_count); i++) {
+			unsigned int from = collapses[i].from, to = collapses[i].to;
+			if(touched[from] || touched[to])
+				continue;
+
+			bool flips = false;
+			size_t removed = 0;
+			for(size_t a = adjacency_offset[from]; (a < adjacency_offset[from + 1]) && !flips; a++) {
+				const unsigned int* triangle = &output[adjacency[a] * 3];
+				if((triangle[0] == to) || (triangle[1] == to) || (triangle[2] == to)) {
+					removed += 3;
+					continue;
+				}
+				glm::vec3 before[3], after[3];
+				for(unsigned char c = 0; c < 3; c++) {
+					if(touched[triangle[c]] && (triangle[c] != from))
+						flips = true;
+					before[c] = vertices[triangle[c]].position;
+					after[c] = (triangle[c] == from) ? vertices[to].position : before[c];
+				}
+				glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if(glm::dot(normal_before, normal_after) <= 0.0f)
+					flips = true;
+			}
+			if(flips)
+				continue;
+
+			remap[from] = to;
+			quadrics[to].add(quadrics[from]);
+			for(size_t a = adjacency_offset[from]; a < adjacency_offset[from + 1]; a++) {
+				const unsigned int* triangle = &output[adjacency[a] * 3];
+				for(unsigned char c = 0; c < 3; c++)
+					touched[triangle[c]] = true;
+			}
+			remaining -= removed;
+			collapsed++;
+		}
+		if(collapsed == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for(size_t i = 0; i < output.size(); i += 3) {
+			unsigned int a = resolve(remap, output[i]), b = resolve(remap, output[i + 1]), c = resolve(remap, output[i + 2]);
+			if((a == b) || (b == c) || (a == c))
+				continue;
+			output[write++] = a;
+			output[write++] = b;
+			output[write++] = c;
+		}
+		output.resize(write);
+	}
+}
+
+void simplify::buildLods(MeshData& mesh, const std::vector<float>& ratios) {
+	mesh.lod_counts.assign(1, mesh.indices.size());
+	size_t full_count = mesh.indices.size();
+	size_t full_vertex_count = mesh.vertices.size();
+
+	// Coarser levels drop hard edges, vertices only differing by normal are merged with an averaged normal
+	// and appended after the full detail ones, so only texture seams have to stay locked
+	VertexMap merged_vertex(lessVertex);
+	std::vector<Vertex> merged;
+	std::vector<unsigned int> previous(mesh.indices.size());
+	for(size_t i = 0; i < mesh.indices.size(); i++) {
+		const Vertex& vertex = mesh.vertices[mesh.indices[i]];
+		std::pair<VertexMap::iterator, bool> inserted = merged_vertex.insert(std::make_pair(vertex, (unsigned int)merged.size()));
+		if(inserted.second) {
+			merged.push_back(vertex);
+			merged.back().normal = glm::vec3(0.0f);
+		}
+		previous[i] = inserted.first->second;
+	}
+	std::vector<bool> normal_added(mesh.vertices.size(), false);
+	for(size_t i = 0; i < mesh.indices.size(); i++) {
+		if(!normal_added[mesh.indices[i]]) {
+			merged[previous[i]].normal += mesh.vertices[mesh.indices[i]].normal;
+			normal_added[mesh.indices[i]] = true;
+		}
+	}
+	if(merged.size() < full_vertex_count) {
+		unsigned int base = full_vertex_count;
+		for(size_t v = 0; v < merged.size(); v++) {
+			float length = glm::length(merged[v].normal);
+			if(length > 0.0f)
+				merged[v].normal /= length;
+			mesh.vertices.push_back(merged[v]);
+		}
+		for(size_t i = 0; i < previous.size(); i++)
+			previous[i] += base;
+	}
+	else
+		previous = mesh.indices;
+
+	for(size_t i = 1; i < ratios.size() && i < max_lods; i++) {
+		size_t target = (size_t)(full_count / 3 * ratios[i]) * 3;
+		std::vector<unsigned int> lod;
+		simplifyIndices(mesh.vertices, previous, target, lod);
+		// Stop once the mesh can not get any simpler
+		if((lod.size() >= previous.size()) || (lod.size() >= mesh.lod_counts.back()))
+			break;
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+		mesh.lod_counts.push_back(lod.size());
+		previous.swap(lod);
+	}
+
+	// Nothing simpler was found, the merged vertices are not needed
+	if(mesh.lod_counts.size() == 1)
+		mesh.vertices.resize(full_vertex_count);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+
+#include "mesh.hpp"
+
+// Quadric error edge collapse (Garland and Heckbert 1997) over an indexed mesh
+namespace simplify {
+	// Collapse edges until at most target_index_count indices are left or nothing can collapse
+	// Vertices on borders and attribute seams stay in place, the vertex array is left untouched
+	void simplifyIndices(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t target_index_count, std::vector<unsigned int>& output);
+
+	// Append one level per ratio of the full mesh (the first one, usually 1.0, is the mesh itself)
+	void buildLods(MeshData& mesh, const std::vector<float>& ratios);
+}
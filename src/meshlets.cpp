@@ -0,0 +1,173 @@
+#include "meshlets.hpp"
+#include "frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <unordered_map>
+
+namespace {
+	struct PositionHash {
+		size_t operator()(const glm::vec3& position) const {
+			uint32_t bits[3];
+			memcpy(bits, &position[0], sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+}
+
+Meshlet meshlets::computeBounds(const MeshData& mesh, unsigned int index_offset, unsigned int index_count) {
+	Meshlet meshlet;
+	meshlet.index_offset = index_offset;
+	meshlet.index_count = index_count;
+
+	// Sphere around the box center of the used vertices
+	glm::vec3 bounds_min = mesh.vertices[mesh.indices[index_offset]].position;
+	glm::vec3 bounds_max = bounds_min;
+	for(unsigned int i = index_offset; i < index_offset + index_count; i++) {
+		bounds_min = glm::min(bounds_min, mesh.vertices[mesh.indices[i]].position);
+		bounds_max = glm::max(bounds_max, mesh.vertices[mesh.indices[i]].position);
+	}
+	glm::vec3 center = 0.5f * (bounds_min + bounds_max);
+	float radius = 0.0f;
+	for(unsigned int i = index_offset; i < index_offset + index_count; i++)
+		radius = std::max(radius, glm::length(mesh.vertices[mesh.indices[i]].position - center));
+
+	// Cone around the average face normal, its cutoff is the sine of the widest angle to a face normal
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis = glm::vec3(0.0f);
+	for(unsigned int i = index_offset; i < index_offset + index_count; i += 3) {
+		glm::vec3 a = mesh.vertices[mesh.indices[i]].position;
+		glm::vec3 normal = glm::cross(mesh.vertices[mesh.indices[i + 1]].position - a, mesh.vertices[mesh.indices[i + 2]].position - a);
+		float length = glm::length(normal);
+		if(length <= 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+	float cutoff = 2.0f; // Never culled
+	if(glm::length(axis) > 0.0f) {
+		axis = glm::normalize(axis);
+		float min_dot = 1.0f;
+		for(size_t i = 0; i < normals.size(); i++)
+			min_dot = std::min(min_dot, glm::dot(axis, normals[i]));
+		// Faces over 90 degrees apart can always be seen from somewhere
+		if(min_dot > 0.0f)
+			cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	}
+
+	for(unsigned char i = 0; i < 3; i++) {
+		meshlet.center[i] = center[i];
+		meshlet.cone_axis[i] = axis[i];
+	}
+	meshlet.radius = radius;
+	meshlet.cone_cutoff = cutoff;
+	return meshlet;
+}
+
+void meshlets::buildMeshlets(MeshData& mesh, unsigned int max_vertices, unsigned int max_triangles) {
+	mesh.meshlets.clear();
+	size_t index_count = mesh.lod_counts.empty() ? mesh.indices.size() : mesh.lod_counts[0];
+	size_t triangle_count = index_count / 3;
+	if(triangle_count == 0)
+		return;
+
+	// Vertices split by texture or normal seams share a position, neighbours are found through it
+	std::vector<unsigned int> position_ids(mesh.vertices.size());
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> positions;
+	for(size_t i = 0; i < mesh.vertices.size(); i++)
+		position_ids[i] = positions.insert(std::make_pair(mesh.vertices[i].position, (unsigned int)positions.size())).first->second;
+
+	// Triangles using each position
+	std::vector<unsigned int> adjacency_offsets(positions.size() + 1, 0);
+	for(size_t i = 0; i < index_count; i++)
+		adjacency_offsets[position_ids[mesh.indices[i]] + 1]++;
+	for(size_t i = 0; i < positions.size(); i++)
+		adjacency_offsets[i + 1] += adjacency_offsets[i];
+	std::vector<unsigned int> adjacency(index_count);
+	std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for(size_t i = 0; i < index_count; i++)
+		adjacency[fill[position_ids[mesh.indices[i]]]++] = i / 3;
+
+	std::vector<bool> emitted(triangle_count, false);
+	// Meshlet (plus one) each vertex was last added to
+	std::vector<unsigned int> vertex_meshlet(mesh.vertices.size(), 0);
+	std::vector<unsigned int> meshlet_vertices;
+	std::vector<unsigned int> ordered;
+	ordered.reserve(index_count);
+
+	// Seeds follow the existing triangle order, already local after the vertex cache optimization
+	size_t seed = 0;
+	unsigned int meshlet_id = 0;
+	while(true) {
+		while((seed < triangle_count) && emitted[seed])
+			seed++;
+		if(seed == triangle_count)
+			break;
+
+		meshlet_id++;
+		meshlet_vertices.clear();
+		unsigned int meshlet_start = ordered.size();
+		unsigned int meshlet_triangles = 0;
+		size_t triangle = seed;
+		while(true) {
+			// Add the triangle and its vertices
+			emitted[triangle] = true;
+			meshlet_triangles++;
+			for(unsigned char c = 0; c < 3; c++) {
+				unsigned int vertex = mesh.indices[triangle * 3 + c];
+				ordered.push_back(vertex);
+				if(vertex_meshlet[vertex] != meshlet_id) {
+					vertex_meshlet[vertex] = meshlet_id;
+					meshlet_vertices.push_back(vertex);
+				}
+			}
+			if(meshlet_triangles >= max_triangles)
+				break;
+
+			// Next the neighbour adding the fewest vertices, while it fits
+			size_t best = triangle_count;
+			unsigned int best_new = 4;
+			for(size_t v = 0; (v < meshlet_vertices.size()) && (best_new > 0); v++) {
+				unsigned int position = position_ids[meshlet_vertices[v]];
+				for(unsigned int a = adjacency_offsets[position]; a < adjacency_offsets[position + 1]; a++) {
+					unsigned int candidate = adjacency[a];
+					if(emitted[candidate])
+						continue;
+					unsigned int new_vertices = 0;
+					for(unsigned char c = 0; c < 3; c++)
+						new_vertices += (vertex_meshlet[mesh.indices[candidate * 3 + c]] != meshlet_id);
+					if(new_vertices < best_new) {
+						best = candidate;
+						best_new = new_vertices;
+						if(best_new == 0)
+							break;
+					}
+				}
+			}
+			if((best == triangle_count) || (meshlet_vertices.size() + best_new > max_vertices))
+				break;
+			triangle = best;
+		}
+		Meshlet meshlet;
+		meshlet.index_offset = meshlet_start;
+		meshlet.index_count = ordered.size() - meshlet_start;
+		mesh.meshlets.push_back(meshlet);
+	}
+
+	// Bounds from the new order
+	std::copy(ordered.begin(), ordered.end(), mesh.indices.begin());
+	for(size_t i = 0; i < mesh.meshlets.size(); i++)
+		mesh.meshlets[i] = computeBounds(mesh, mesh.meshlets[i].index_offset, mesh.meshlets[i].index_count);
+}
+
+bool meshlets::isCulled(const Meshlet& meshlet, const Frustum& frustum, glm::vec3 camera_position) {
+	glm::vec3 center = glm::vec3(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+	if(!frustum.intersectsSphere(center, meshlet.radius))
+		return true;
+
+	// Every face points away when the view direction is within the cone, widened by the sphere
+	glm::vec3 axis = glm::vec3(meshlet.cone_axis[0], meshlet.cone_axis[1], meshlet.cone_axis[2]);
+	glm::vec3 view = center - camera_position;
+	return glm::dot(view, axis) >= meshlet.cone_cutoff * glm::length(view) + meshlet.radius;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+
+#include "mesh.hpp"
+
+// Splitting of the finest level of detail into small clusters culled one by one
+namespace meshlets {
+	// Cluster limits within the 64 vertex / 126 triangle hardware limits of mesh shaders, 124 rather than 126 triangles
+	// keeps the triangle count a multiple of 4, so the 8 bit local indices of a meshlet fill whole 32 bit words
+	const unsigned int max_vertices = 64;
+	const unsigned int max_triangles = 124;
+
+	// Regroup the triangles of the first level into meshlets grown over shared vertices,
+	// reordering them so each meshlet is a contiguous index range, and compute their bounds
+	void buildMeshlets(MeshData& mesh, unsigned int max_vertices = meshlets::max_vertices, unsigned int max_triangles = meshlets::max_triangles);
+
+	// Bounding sphere and normal cone of the triangles in [index_offset, index_offset + index_count)
+	Meshlet computeBounds(const MeshData& mesh, unsigned int index_offset, unsigned int index_count);
+
+	// Meshlet entirely outside the frustum or facing away from the camera, both given in mesh space
+	bool isCulled(const Meshlet& meshlet, const Frustum& frustum, glm::vec3 camera_position);
+}
@@ -0,0 +1,319 @@
+#include "objParser.hpp"
+#include "mappedFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <unordered_map>
+#include <stdint.h>
+#include <stdexcept>
+
+namespace {
+	const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool isDigit(char c) {
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	inline bool isBlank(char c) {
+		return (c == ' ') || (c == '\t') || (c == '\r');
+	}
+
+	inline void skipBlanks(const char*& cursor, const char* end) {
+		while((cursor < end) && isBlank(*cursor))
+			cursor++;
+	}
+
+	inline void skipLine(const char*& cursor, const char* end) {
+		while((cursor < end) && (*cursor != '\n'))
+			cursor++;
+	}
+
+	// Decimal float in place, the mantissa is kept exact up to 19 digits and scaled once
+	inline float parseFloat(const char*& cursor, const char* end) {
+		bool negative = false;
+		if((cursor < end) && ((*cursor == '-') || (*cursor == '+'))) {
+			negative = (*cursor == '-');
+			cursor++;
+		}
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		while((cursor < end) && isDigit(*cursor)) {
+			if(digits < 19) {
+				mantissa = mantissa * 10 + (*cursor - '0');
+				if(mantissa)
+					digits++;
+			}
+			else
+				exponent++;
+			cursor++;
+		}
+		if((cursor < end) && (*cursor == '.')) {
+			cursor++;
+			while((cursor < end) && isDigit(*cursor)) {
+				if(digits < 19) {
+					mantissa = mantissa * 10 + (*cursor - '0');
+					if(mantissa)
+						digits++;
+					exponent--;
+				}
+				cursor++;
+			}
+		}
+		if((cursor < end) && ((*cursor == 'e') || (*cursor == 'E'))) {
+			cursor++;
+			bool negative_exponent = false;
+			if((cursor < end) && ((*cursor == '-') || (*cursor == '+'))) {
+				negative_exponent = (*cursor == '-');
+				cursor++;
+			}
+			int value = 0;
+			while((cursor < end) && isDigit(*cursor)) {
+				if(value < 10000)
+					value = value * 10 + (*cursor - '0');
+				cursor++;
+			}
+			exponent += negative_exponent ? -value : value;
+		}
+
+		double value = (double)mantissa;
+		if(exponent < 0)
+			value = (exponent >= -22) ? value / powers_of_ten[-exponent] : value * std::pow(10.0, exponent);
+		else if(exponent > 0)
+			value = (exponent <= 22) ? value * powers_of_ten[exponent] : value * std::pow(10.0, exponent);
+		return (float)(negative ? -value : value);
+	}
+
+	inline int parseInt(const char*& cursor, const char* end) {
+		bool negative = false;
+		if((cursor < end) && ((*cursor == '-') || (*cursor == '+'))) {
+			negative = (*cursor == '-');
+			cursor++;
+		}
+		int value = 0;
+		while((cursor < end) && isDigit(*cursor)) {
+			value = value * 10 + (*cursor - '0');
+			cursor++;
+		}
+		return negative ? -value : value;
+	}
+
+	struct CornerHash {
+		size_t operator()(const glm::ivec3& corner) const {
+			uint64_t key = ((uint64_t)(uint32_t)corner.x * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)(uint32_t)corner.y * 0xC2B2AE3D27D4EB4Full) ^ ((uint64_t)(uint32_t)corner.z * 0x165667B19E3779F9ull);
+			return (size_t)(key ^ (key >> 32));
+		}
+	};
+
+	// Obj indices are 1-based, negative ones are relative to the current end of the list
+	inline int resolveIndex(int index, size_t count) {
+		if(index > 0)
+			return index - 1;
+		if(index < 0)
+			return (int)count + index;
+		return -1;
+	}
+
+	// Bit i of relative_mask is set when component i was written relative to the counts of data
+	inline glm::ivec3 parseCorner(const char*& cursor, const char* end, const obj::ObjData& data, unsigned char& relative_mask) {
+		glm::ivec3 corner(-1);
+		relative_mask = 0;
+		int index = parseInt(cursor, end);
+		corner.x = resolveIndex(index, data.positions.size());
+		relative_mask |= (index < 0) ? 1 : 0;
+		if((cursor < end) && (*cursor == '/')) {
+			cursor++;
+			if((cursor < end) && (*cursor != '/')) {
+				index = parseInt(cursor, end);
+				corner.y = resolveIndex(index, data.textures.size());
+				relative_mask |= (index < 0) ? 2 : 0;
+			}
+			if((cursor < end) && (*cursor == '/')) {
+				cursor++;
+				index = parseInt(cursor, end);
+				corner.z = resolveIndex(index, data.normals.size());
+				relative_mask |= (index < 0) ? 4 : 0;
+			}
+		}
+		return corner;
+	}
+
+	inline void pushCorner(obj::ObjData& data, const glm::ivec3& corner, unsigned char relative_mask) {
+		for(unsigned char i = 0; i < 3; i++) {
+			if(relative_mask & (1 << i))
+				data.relative_corners.push_back(data.corners.size() * 3 + i);
+		}
+		data.corners.push_back(corner);
+	}
+
+	// Chunks only pay off for large files
+	const size_t min_chunk_size = 256 * 1024;
+}
+
+unsigned char obj::parse(const char* begin, const char* end, ObjData& data) {
+	const char* cursor = begin;
+	while(cursor < end) {
+		skipBlanks(cursor, end);
+		if(cursor >= end)
+			break;
+
+		// Get type
+		if(cursor[0] == 'v') {
+			char type = ((cursor + 1) < end) ? cursor[1] : '\n';
+			// Position
+			if(isBlank(type)) {
+				cursor++;
+				glm::vec3 temp_pos;
+				for(unsigned char i = 0; i < 3; i++) {
+					skipBlanks(cursor, end);
+					temp_pos[i] = parseFloat(cursor, end);
+				}
+				data.positions.push_back(temp_pos);
+			}
+			// Texture
+			else if(type == 't') {
+				cursor += 2;
+				glm::vec2 temp_pos;
+				for(unsigned char i = 0; i < 2; i++) {
+					skipBlanks(cursor, end);
+					temp_pos[i] = parseFloat(cursor, end);
+				}
+				data.textures.push_back(temp_pos);
+			}
+			// Normal
+			else if(type == 'n') {
+				cursor += 2;
+				glm::vec3 temp_pos;
+				for(unsigned char i = 0; i < 3; i++) {
+					skipBlanks(cursor, end);
+					temp_pos[i] = parseFloat(cursor, end);
+				}
+				data.normals.push_back(temp_pos);
+			}
+		}
+		// Face
+		else if((cursor[0] == 'f') && ((cursor + 1) < end) && isBlank(cursor[1])) {
+			cursor++;
+			glm::ivec3 first(-1), previous(-1);
+			unsigned char first_mask = 0, previous_mask = 0;
+			unsigned int corner_count = 0;
+			while(true) {
+				skipBlanks(cursor, end);
+				if((cursor >= end) || !((*cursor == '-') || isDigit(*cursor)))
+					break;
+				unsigned char relative_mask;
+				glm::ivec3 corner = parseCorner(cursor, end, data, relative_mask);
+				if(corner_count >= 3) {
+					pushCorner(data, first, first_mask);
+					pushCorner(data, previous, previous_mask);
+				}
+				else if(corner_count == 0) {
+					first = corner;
+					first_mask = relative_mask;
+				}
+				pushCorner(data, corner, relative_mask);
+				previous = corner;
+				previous_mask = relative_mask;
+				corner_count++;
+			}
+			if((corner_count > 0) && (corner_count < 3))
+				throw std::runtime_error("Obj face with less than 3 corners");
+		}
+
+		skipLine(cursor, end);
+		cursor++;
+	}
+
+	return 0;
+}
+
+unsigned char obj::parseChunked(const char* begin, const char* end, ObjData& data, ThreadPool& pool, unsigned int chunk_count) {
+	if(chunk_count <= 1)
+		return parse(begin, end, data);
+
+	// Split at newline boundaries
+	std::vector<const char*> bounds;
+	bounds.push_back(begin);
+	size_t chunk_size = (end - begin) / chunk_count;
+	for(unsigned int i = 1; i < chunk_count; i++) {
+		const char* split = std::max(bounds.back(), begin + i * chunk_size);
+		split = (const char*)memchr(split, '\n', end - split);
+		split = split ? split + 1 : end;
+		bounds.push_back(split);
+	}
+	bounds.push_back(end);
+
+	std::vector<ObjData> chunks(chunk_count);
+	pool.parallelFor(chunk_count, [&](size_t i) {
+		parse(bounds[i], bounds[i + 1], chunks[i]);
+	}, chunk_count);
+
+	// Merge in file order, then move indices written relative to a chunk onto the merged lists
+	size_t position_count = 0, texture_count = 0, normal_count = 0, corner_count = 0;
+	for(unsigned int i = 0; i < chunk_count; i++) {
+		position_count += chunks[i].positions.size();
+		texture_count += chunks[i].textures.size();
+		normal_count += chunks[i].normals.size();
+		corner_count += chunks[i].corners.size();
+	}
+	data.positions.reserve(data.positions.size() + position_count);
+	data.textures.reserve(data.textures.size() + texture_count);
+	data.normals.reserve(data.normals.size() + normal_count);
+	data.corners.reserve(data.corners.size() + corner_count);
+	for(unsigned int i = 0; i < chunk_count; i++) {
+		ObjData& chunk = chunks[i];
+		glm::ivec3 base(data.positions.size(), data.textures.size(), data.normals.size());
+		size_t corner_base = data.corners.size();
+		data.positions.insert(data.positions.end(), chunk.positions.begin(), chunk.positions.end());
+		data.textures.insert(data.textures.end(), chunk.textures.begin(), chunk.textures.end());
+		data.normals.insert(data.normals.end(), chunk.normals.begin(), chunk.normals.end());
+		data.corners.insert(data.corners.end(), chunk.corners.begin(), chunk.corners.end());
+		for(size_t j = 0; j < chunk.relative_corners.size(); j++) {
+			size_t slot = chunk.relative_corners[j];
+			data.corners[corner_base + slot / 3][slot % 3] += base[slot % 3];
+		}
+	}
+
+	return 0;
+}
+
+unsigned char obj::load(std::string obj_file_path, MeshData& mesh, ThreadPool* pool, unsigned int chunk_count) {
+	MappedFile obj_file;
+	obj_file.open(obj_file_path);
+
+	ObjData data;
+	if(pool && (chunk_count == 0))
+		chunk_count = std::min<size_t>(pool->size() + 1, obj_file.size() / min_chunk_size);
+	if(pool && (chunk_count > 1))
+		parseChunked(obj_file.data(), obj_file.data() + obj_file.size(), data, *pool, chunk_count);
+	else
+		parse(obj_file.data(), obj_file.data() + obj_file.size(), data);
+
+	// Weld corners sharing the same (position, texture, normal) triple into one vertex
+	std::unordered_map<glm::ivec3, unsigned int, CornerHash> welded;
+	welded.reserve(data.corners.size());
+	mesh.vertices.reserve(data.corners.size() / 3);
+	mesh.indices.resize(data.corners.size());
+	for(size_t i = 0; i < data.corners.size(); i++) {
+		const glm::ivec3& corner = data.corners[i];
+		std::pair<std::unordered_map<glm::ivec3, unsigned int, CornerHash>::iterator, bool> inserted = welded.insert(std::make_pair(corner, (unsigned int)mesh.vertices.size()));
+		if(inserted.second) {
+			if((corner.x < 0) || (corner.x >= (int)data.positions.size()))
+				throw std::runtime_error(std::string("Invalid position index in obj file: ")+obj_file_path);
+			Vertex temp_vertex;
+			temp_vertex.position = data.positions[corner.x];
+			temp_vertex.texture = ((corner.y >= 0) && (corner.y < (int)data.textures.size())) ? data.textures[corner.y] : glm::vec2(0.0f);
+			temp_vertex.normal = ((corner.z >= 0) && (corner.z < (int)data.normals.size())) ? data.normals[corner.z] : glm::vec3(0.0f);
+			mesh.vertices.push_back(temp_vertex);
+		}
+		mesh.indices[i] = inserted.first->second;
+	}
+	computeBounds(mesh);
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "threadPool.hpp"
+
+namespace obj {
+	// Attribute streams as they appear in the file
+	// Each corner holds 0-based (position, texture, normal) indices, -1 when absent
+	struct ObjData {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> textures;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::ivec3> corners;
+
+		// Negative (relative) obj indices resolved against this data only, as corner * 3 + component
+		std::vector<size_t> relative_corners;
+	};
+
+	// Parse the text in [begin, end), faces with more than 3 corners are triangulated as fans
+	unsigned char parse(const char* begin, const char* end, ObjData& data);
+
+	// Same result as parse, with chunks split at newlines and parsed over the pool
+	unsigned char parseChunked(const char* begin, const char* end, ObjData& data, ThreadPool& pool, unsigned int chunk_count);
+
+	// Map and parse an obj file into a mesh ready to upload
+	// Large files are parsed in parallel when a pool is given, chunk_count zero picks it from the file size
+	unsigned char load(std::string obj_file_path, MeshData& mesh, ThreadPool* pool = nullptr, unsigned int chunk_count = 0);
+}
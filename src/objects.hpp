@@ -5,25 +5,33 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include "mesh.hpp"
+#include "meshRegistry.hpp"
+#include "textureRegistry.hpp"
+#include "virtualTexture.hpp"
+#include "assetLoader.hpp"
+#include "frustum.hpp"
+#include "frameStats.hpp"
+#include "shaderRegistry.hpp"
+#include "renderQueue.hpp"
+
 #include "lights.hpp"
 
 class Object {
 private:
-	std::string shader_vert_file;
-	std::string shader_frag_file;
-
 	std::string obj_file;
 
-	unsigned int shader_program;
+	std::shared_ptr<ShaderProgram> shader;
 
-	unsigned int vertex_buffer;
-	unsigned int vertex_array;
-	unsigned int index_buffer;
+	std::shared_ptr<Mesh> mesh;
+	unsigned int lod_level = 0;
 
-	unsigned int element_count = 0;
+	std::shared_ptr<Texture> texture;
+	std::shared_ptr<Texture> normal_map;
+	std::shared_ptr<VirtualTexture> virtual_texture;
 
-	unsigned int texture_id;
-	unsigned int normal_map_id;
+	// Model matrix of every instance when drawn instanced
+	std::shared_ptr<InstanceBuffer> instances;
 
 	unsigned int position_size;
 	unsigned int texture_size;
@@ -36,13 +44,24 @@ public:
 	std::string name;
 	glm::mat4 model_mat = glm::mat4(1.0f);
 
-	unsigned char createBuffer(glm::mat4 initial_mat, std::string obj_file_path = "");
-	unsigned char createShaderProgram(std::string shader_vertex, std::string shader_fragment);
-	unsigned char createTexture(std::string texture_file_path = "", std::string normal_map_file_path = "");
-	unsigned char draw(std::vector<Light> lights, glm::mat4* projection, glm::mat4* view, glm::mat4* model);
+	unsigned char createBuffer(glm::mat4 initial_mat, MeshRegistry& meshes, std::string obj_file_path = "", const MeshSettings& settings = MeshSettings(), AssetLoader* loader = nullptr);
+	unsigned char createShaderProgram(ShaderRegistry& shaders, std::string shader_vertex, std::string shader_fragment, AssetLoader* loader = nullptr);
+	unsigned char selectLod(glm::mat4* projection, glm::mat4* view, glm::mat4* model, const LodSettings& settings);
+	unsigned char createTexture(TextureRegistry& textures, std::string texture_file_path = "", std::string normal_map_file_path = "", const TextureSettings& settings = TextureSettings(), AssetLoader* loader = nullptr);
+	unsigned char createVirtualTexture(std::string texture_file_path, const VirtualTextureSettings& settings, AssetLoader* loader = nullptr);
+	unsigned char streamTiles(glm::mat4* projection, glm::mat4* view, glm::mat4* model, int viewport_height, FrameStats* stats = nullptr);
+	unsigned char enqueue(RenderQueue& queue, glm::mat4* model);
+
+	// Draw the object once per model in a single draw from now on, with a shader reading them from the Instances block
+	unsigned char setInstances(const std::vector<glm::mat4>& models);
+
+	// Drawn once its shader, mesh and textures are loaded
+	bool isReady() const { return shader && shader->isReady() && mesh && mesh->isUploaded() && (!texture || texture->isUploaded()) && (!normal_map || normal_map->isUploaded()) &&
+		(!virtual_texture || virtual_texture->isUploaded()); }
 
-	glm::vec3 getPosition();
-	glm::quat getRotation();
+	// Mesh bounds under the model matrix intersect the frustum
+	bool isVisible(const Frustum& frustum, glm::mat4* model) const { return mesh && mesh->isVisible(frustum, *model); }
 
-	~Object();
+	glm::vec3 getPosition() const;
+	glm::quat getRotation() const;
 };
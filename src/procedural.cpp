@@ -0,0 +1,331 @@
+#include "procedural.hpp"
+
+#include <algorithm>
+#include <ctype.h>
+#include <cmath>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+
+namespace {
+	const float pi = 3.14159265358979f;
+
+	enum class Shape {
+		UV_SPHERE,
+		CUBE_SPHERE,
+		ICO_SPHERE
+	};
+
+	// Weld points generated twice along shared edges, they are computed from the same values so they match exactly
+	struct PointHash {
+		size_t operator()(const glm::vec3& point) const {
+			uint32_t bits[3];
+			memcpy(bits, &point[0], sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	class PointSet {
+	public:
+		std::vector<glm::vec3> points;
+		std::unordered_map<glm::vec3, unsigned int, PointHash> indices;
+
+		unsigned int add(glm::vec3 point) {
+			auto found = indices.find(point);
+			if(found != indices.end())
+				return found->second;
+			indices[point] = points.size();
+			points.push_back(point);
+			return points.size() - 1;
+		}
+	};
+
+	void uvSphere(unsigned int bands, std::vector<glm::vec3>& points, std::vector<unsigned int>& triangles) {
+		bands = std::max(bands, 2u);
+		unsigned int segments = 2 * bands;
+
+		// Single vertex at each pole, rings from the north pole down
+		points.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+		for(unsigned int ring = 1; ring < bands; ring++) {
+			float latitude = pi / 2 - pi * ring / bands;
+			for(unsigned int segment = 0; segment < segments; segment++) {
+				float longitude = -pi + 2 * pi * segment / segments;
+				points.push_back(glm::vec3(std::cos(latitude) * std::sin(longitude), std::sin(latitude), std::cos(latitude) * std::cos(longitude)));
+			}
+		}
+		points.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+
+		unsigned int south = points.size() - 1;
+		for(unsigned int segment = 0; segment < segments; segment++) {
+			unsigned int next = (segment + 1) % segments;
+			triangles.insert(triangles.end(), {0, 1 + segment, 1 + next});
+			for(unsigned int ring = 1; ring + 1 < bands; ring++) {
+				unsigned int top = 1 + (ring - 1) * segments;
+				unsigned int bottom = top + segments;
+				triangles.insert(triangles.end(), {top + segment, bottom + segment, bottom + next});
+				triangles.insert(triangles.end(), {top + segment, bottom + next, top + next});
+			}
+			unsigned int last = 1 + (bands - 2) * segments;
+			triangles.insert(triangles.end(), {last + segment, south, last + next});
+		}
+	}
+
+	void cubeSphere(unsigned int quads, std::vector<glm::vec3>& points, std::vector<unsigned int>& triangles) {
+		// Even, so the poles are vertices and no triangle spans half the texture around them
+		quads = std::max(quads + quads % 2, 2u);
+		PointSet point_set;
+
+		// Equal angle spacing along each face keeps the cells close in size once on the sphere
+		std::vector<float> steps(quads + 1);
+		for(unsigned int i = 0; i <= quads; i++)
+			steps[i] = std::tan((2.0f * i / quads - 1.0f) * pi / 4);
+		steps[0] = -1.0f;
+		steps[quads / 2] = 0.0f;
+		steps[quads] = 1.0f;
+
+		for(unsigned int face = 0; face < 6; face++) {
+			unsigned int axis = face / 2;
+			float side = (face % 2 == 0) ? 1.0f : -1.0f;
+			std::vector<unsigned int> grid((quads + 1) * (quads + 1));
+			for(unsigned int row = 0; row <= quads; row++) {
+				for(unsigned int column = 0; column <= quads; column++) {
+					glm::vec3 point;
+					point[axis] = side;
+					point[(axis + 1) % 3] = steps[column];
+					point[(axis + 2) % 3] = steps[row];
+					grid[row * (quads + 1) + column] = point_set.add(glm::normalize(point));
+				}
+			}
+			for(unsigned int row = 0; row < quads; row++) {
+				for(unsigned int column = 0; column < quads; column++) {
+					unsigned int corner = row * (quads + 1) + column;
+					triangles.insert(triangles.end(), {grid[corner], grid[corner + 1], grid[corner + quads + 2]});
+					triangles.insert(triangles.end(), {grid[corner], grid[corner + quads + 2], grid[corner + quads + 1]});
+				}
+			}
+		}
+		points.swap(point_set.points);
+	}
+
+	void icoSphere(unsigned int subdivisions, std::vector<glm::vec3>& points, std::vector<unsigned int>& triangles) {
+		const float t = (1.0f + std::sqrt(5.0f)) / 2;
+		const glm::vec3 corners[12] = {
+			{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+			{0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+			{t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+		};
+		for(unsigned int i = 0; i < 12; i++)
+			points.push_back(glm::normalize(corners[i]));
+		triangles = {	0, 11, 5,	0, 5, 1,	0, 1, 7,	0, 7, 10,	0, 10, 11,
+						1, 5, 9,	5, 11, 4,	11, 10, 2,	10, 7, 6,	7, 1, 8,
+						3, 9, 4,	3, 4, 2,	3, 2, 6,	3, 6, 8,	3, 8, 9,
+						4, 9, 5,	2, 4, 11,	6, 2, 10,	8, 6, 7,	9, 8, 1};
+
+		// Split every triangle in four, edge midpoints shared between neighbours
+		for(unsigned int level = 0; level < subdivisions; level++) {
+			std::unordered_map<uint64_t, unsigned int> midpoints;
+			std::vector<unsigned int> split;
+			split.reserve(triangles.size() * 4);
+			auto midpoint = [&](unsigned int a, unsigned int b) {
+				uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+				auto found = midpoints.find(key);
+				if(found != midpoints.end())
+					return found->second;
+				points.push_back(glm::normalize(points[a] + points[b]));
+				midpoints[key] = points.size() - 1;
+				return (unsigned int)points.size() - 1;
+			};
+			for(size_t i = 0; i < triangles.size(); i += 3) {
+				unsigned int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+				unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+				split.insert(split.end(), {a, ab, ca,	b, bc, ab,	c, ca, bc,	ab, bc, ca});
+			}
+			triangles.swap(split);
+		}
+	}
+
+	void generate(Shape shape, unsigned int detail, std::vector<glm::vec3>& points, std::vector<unsigned int>& triangles) {
+		switch(shape) {
+			case Shape::UV_SPHERE:
+				uvSphere(detail, points, triangles);
+				break;
+			case Shape::CUBE_SPHERE:
+				cubeSphere(detail, points, triangles);
+				break;
+			case Shape::ICO_SPHERE:
+				icoSphere(detail, points, triangles);
+				break;
+		}
+	}
+
+	glm::vec2 sphereTexture(glm::vec3 point) {
+		return glm::vec2((std::atan2(point.x, point.z) + pi) / (2 * pi), std::asin(std::min(std::max(point.y, -1.0f), 1.0f)) / pi + 0.5f);
+	}
+
+	// Append unit sphere points as vertices, then the triangles facing out
+	// Triangles across the u seam get copies shifted by one, pole vertices one copy per triangle at the middle u
+	void appendSphere(const std::vector<glm::vec3>& points, const std::vector<unsigned int>& triangles, float texture_repeat, MeshData& mesh) {
+		unsigned int base = mesh.vertices.size();
+		for(size_t i = 0; i < points.size(); i++) {
+			Vertex vertex;
+			vertex.position = points[i];
+			vertex.texture = sphereTexture(points[i]) * texture_repeat;
+			vertex.normal = points[i];
+			mesh.vertices.push_back(vertex);
+		}
+
+		std::unordered_map<unsigned int, unsigned int> wrapped_up;
+		std::unordered_map<unsigned int, unsigned int> wrapped_down;
+		for(size_t i = 0; i < triangles.size(); i += 3) {
+			unsigned int corners[3] = {triangles[i], triangles[i + 1], triangles[i + 2]};
+			glm::vec3 normal = glm::cross(points[corners[1]] - points[corners[0]], points[corners[2]] - points[corners[0]]);
+			if(glm::dot(normal, points[corners[0]] + points[corners[1]] + points[corners[2]]) < 0.0f)
+				std::swap(corners[1], corners[2]);
+
+			bool pole[3];
+			float u[3];
+			float u_min = 2.0f, u_max = -1.0f;
+			for(unsigned int c = 0; c < 3; c++) {
+				glm::vec3 point = points[corners[c]];
+				pole[c] = (point.x * point.x + point.z * point.z) < 1e-10f;
+				u[c] = sphereTexture(point).x;
+				if(!pole[c]) {
+					u_min = std::min(u_min, u[c]);
+					u_max = std::max(u_max, u[c]);
+				}
+			}
+			bool seam = (u_max - u_min) > 0.5f;
+
+			// Bring corners lying on the seam at u = 1 down to 0 when possible, keeping u within [0, 1]
+			bool shift_down = true;
+			for(unsigned int c = 0; c < 3; c++) {
+				if(!pole[c] && (u[c] >= 0.5f) && (u[c] < 1.0f - 1e-4f))
+					shift_down = false;
+			}
+
+			float u_sum = 0.0f;
+			unsigned int u_count = 0;
+			for(unsigned int c = 0; c < 3; c++) {
+				if(pole[c])
+					continue;
+				if(seam && ((u[c] >= 0.5f) == shift_down)) {
+					u[c] += shift_down ? -1.0f : 1.0f;
+					std::unordered_map<unsigned int, unsigned int>& copies = shift_down ? wrapped_down : wrapped_up;
+					auto found = copies.find(corners[c]);
+					if(found == copies.end()) {
+						Vertex vertex = mesh.vertices[base + corners[c]];
+						vertex.texture.x = u[c] * texture_repeat;
+						found = copies.insert(std::make_pair(corners[c], (unsigned int)mesh.vertices.size() - base)).first;
+						mesh.vertices.push_back(vertex);
+					}
+					corners[c] = found->second;
+				}
+				u_sum += u[c];
+				u_count++;
+			}
+			for(unsigned int c = 0; c < 3; c++) {
+				if(!pole[c])
+					continue;
+				Vertex vertex = mesh.vertices[base + corners[c]];
+				vertex.texture.x = (u_count > 0 ? u_sum / u_count : 0.5f) * texture_repeat;
+				corners[c] = mesh.vertices.size() - base;
+				mesh.vertices.push_back(vertex);
+			}
+
+			for(unsigned int c = 0; c < 3; c++)
+				mesh.indices.push_back(base + corners[c]);
+		}
+	}
+
+	// Around 5 million triangles at most, an icosphere above 9 subdivisions would not fit 32 bit indices
+	unsigned long maxDetail(Shape shape) {
+		if(shape == Shape::UV_SPHERE)
+			return 1024; // 4 N^2 triangles
+		if(shape == Shape::CUBE_SPHERE)
+			return 512; // 12 N^2 triangles
+		return 9; // 20 4^N triangles
+	}
+
+	// Detail of a level with the given triangle ratio of the full mesh
+	unsigned int lodDetail(Shape shape, unsigned int detail, float ratio) {
+		if(shape == Shape::ICO_SPHERE) {
+			// Each subdivision multiplies the triangles by four
+			int removed = (int)std::round(std::log(1.0f / ratio) / std::log(4.0f));
+			return std::max((int)detail - removed, 0);
+		}
+		return std::max((unsigned int)std::round(detail * std::sqrt(ratio)), shape == Shape::UV_SPHERE ? 2u : 1u);
+	}
+}
+
+bool procedural::handles(std::string file_path) {
+	return file_path.compare(0, strlen(prefix), prefix) == 0;
+}
+
+unsigned char procedural::load(std::string name, MeshData& mesh, const std::vector<float>& lod_ratios) {
+	// procedural:<shape>:<detail>[:<texture repeat>]
+	std::vector<std::string> fields;
+	size_t start = strlen(prefix);
+	while(true) {
+		size_t end = name.find(':', start);
+		fields.push_back(name.substr(start, end - start));
+		if(end == std::string::npos)
+			break;
+		start = end + 1;
+	}
+	if((fields.size() < 2) || (fields.size() > 3)) {
+		throw std::runtime_error(std::string("Invalid procedural mesh, expected procedural:<shape>:<detail>[:<texture repeat>]: ")+name);
+		return -1;
+	}
+
+	Shape shape;
+	if(fields[0].compare("uvsphere") == 0)
+		shape = Shape::UV_SPHERE;
+	else if(fields[0].compare("cubesphere") == 0)
+		shape = Shape::CUBE_SPHERE;
+	else if(fields[0].compare("icosphere") == 0)
+		shape = Shape::ICO_SPHERE;
+	else {
+		throw std::runtime_error(std::string("Unknown procedural shape [")+fields[0]+std::string("] in: ")+name);
+		return -1;
+	}
+
+	// Whole fields only, strtoul would also take a sign and both stop silently at the first other character
+	char* end = nullptr;
+	unsigned long detail = strtoul(fields[1].c_str(), &end, 10);
+	if(fields[1].empty() || !isdigit((unsigned char)fields[1][0]) || (*end != '\0')) {
+		throw std::runtime_error(std::string("Invalid procedural detail [")+fields[1]+std::string("] in: ")+name);
+		return -1;
+	}
+	float texture_repeat = 1.0f;
+	if(fields.size() == 3) {
+		texture_repeat = strtof(fields[2].c_str(), &end);
+		if(fields[2].empty() || (*end != '\0') || !std::isfinite(texture_repeat)) {
+			throw std::runtime_error(std::string("Invalid procedural texture repeat [")+fields[2]+std::string("] in: ")+name);
+			return -1;
+		}
+	}
+	if(detail > maxDetail(shape)) {
+		throw std::runtime_error(std::string("Procedural ")+fields[0]+std::string(" detail is limited to ")+std::to_string(maxDetail(shape))+std::string(", around 5 million triangles: ")+name);
+		return -1;
+	}
+
+	std::vector<float> ratios = lod_ratios;
+	if(ratios.empty())
+		ratios.push_back(1.0f);
+	ratios.resize(std::min<size_t>(ratios.size(), max_lods));
+
+	for(size_t lod = 0; lod < ratios.size(); lod++) {
+		size_t index_start = mesh.indices.size();
+		std::vector<glm::vec3> points;
+		std::vector<unsigned int> triangles;
+		generate(shape, lodDetail(shape, detail, ratios[lod]), points, triangles);
+		appendSphere(points, triangles, texture_repeat, mesh);
+		if(ratios.size() > 1)
+			mesh.lod_counts.push_back(mesh.indices.size() - index_start);
+	}
+	computeBounds(mesh);
+
+	return 0;
+}
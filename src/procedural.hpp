@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+
+// Built in meshes generated at load time, named in place of an obj file:
+// procedural:<shape>:<detail>[:<texture repeat>]
+//   uvsphere:N    N latitude bands and 2N longitude segments
+//   cubesphere:N  cube with N x N quads per face (N rounded up to even), pushed out to the sphere
+//   icosphere:N   icosahedron subdivided N times
+// Spheres have unit radius, normals pointing out and the equirectangular mapping of earth.obj
+// (u along the longitude from -Z through -X, v along the latitude from the south pole)
+namespace procedural {
+	const char prefix[] = "procedural:";
+
+	bool handles(std::string file_path);
+
+	// Generate the mesh, one tessellation per level of detail ratio
+	unsigned char load(std::string name, MeshData& mesh, const std::vector<float>& lod_ratios = std::vector<float>());
+}
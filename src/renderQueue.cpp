@@ -0,0 +1,215 @@
+#include "renderQueue.hpp"
+
+#include "glCalls.hpp"
+#include <algorithm>
+#include <string.h>
+
+#include "textureArray.hpp"
+
+namespace {
+	const int pass_shift = 62;
+
+	// Bits of a positive float sort like the float itself
+	uint32_t depthBits(float depth) {
+		depth = std::max(depth, 0.0f);
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		return bits;
+	}
+
+	// Drawn with the others of its batch, from the shared buffers of its arena
+	bool isBatched(const DrawPacket& packet) {
+		return packet.uniforms->draw_data && packet.mesh->getArena() && !packet.instances && !packet.virtual_texture;
+	}
+
+	bool sharesBatch(const DrawPacket& first, const DrawPacket& packet) {
+		return isBatched(packet) && (packet.program == first.program) && (packet.mesh->getVertexArray() == first.mesh->getVertexArray()) &&
+			(packet.texture_array == first.texture_array) && (packet.normal_map_array == first.normal_map_array) && (packet.blended == first.blended);
+	}
+}
+
+void RenderQueue::begin(const glm::mat4& view, const glm::mat4& projection) {
+	this->view = view;
+	this->projection = projection;
+	packets.clear();
+	order.clear();
+}
+
+uint64_t RenderQueue::makeKey(const DrawPacket& packet) const {
+	glm::vec4 center = view * packet.model * glm::vec4(packet.mesh->bounding_center, 1.0f);
+	uint32_t depth = depthBits(-center.z);
+
+	uint64_t program = packet.program & 0x3fff;
+	uint64_t textures = packet.virtual_texture ? packet.virtual_texture->getAtlasId() : packet.texture_array;
+	textures = ((textures & 0xff) << 8) | (packet.normal_map_array & 0xff);
+	uint64_t vertex_array = packet.mesh->getVertexArray() & 0xffff;
+
+	if(packet.blended)
+		return (1ull << pass_shift) | ((uint64_t)(~depth) << 30) | (program << 16) | textures;
+	// Top 16 bits of the depth, sign, exponent and the start of the mantissa
+	return (program << 48) | (textures << 32) | (vertex_array << 16) | (depth >> 16);
+}
+
+void RenderQueue::add(const DrawPacket& packet) {
+	SortEntry entry;
+	entry.key = makeKey(packet);
+	entry.index = packets.size();
+	order.push_back(entry);
+	packets.push_back(packet);
+}
+
+void RenderQueue::submit(FrameStats* stats) {
+	std::sort(order.begin(), order.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+
+	// State left by the previous packet, nothing is assumed bound at the start
+	unsigned int program = 0;
+	unsigned int vertex_array = 0;
+	const Mesh* mesh = nullptr;
+	const VirtualTexture* virtual_texture = nullptr;
+	int texture_layer = -1;
+	int normal_map_layer = -1;
+
+	FrameStats counts;
+	size_t next = 0;
+	while(next < order.size()) {
+		const DrawPacket& packet = packets[order[next].index];
+		const UniformLocations& uniforms = *packet.uniforms;
+
+		// The packets after it sharing all of its state join its multi draw
+		size_t batch_end = next;
+		if(isBatched(packet))
+			while((batch_end < order.size()) && sharesBatch(packet, packets[order[batch_end].index]))
+				batch_end++;
+		bool batched = batch_end > next;
+
+		// The uniforms below belong to the program, a new one starts from scratch
+		if(packet.program != program) {
+			glUseProgram(packet.program);
+			program = packet.program;
+			mesh = nullptr;
+			virtual_texture = nullptr;
+			texture_layer = normal_map_layer = -1;
+			counts.program_switches++;
+		}
+		if(!batched) {
+			glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, &packet.model[0][0]);
+			if(uniforms.light_color != -1)
+				glUniform3f(uniforms.light_color, packet.light_color.r, packet.light_color.g, packet.light_color.b);
+		}
+
+		// Vertex dequantization, meshes in an arena are never quantized
+		if(!batched && (packet.mesh != mesh)) {
+			glm::vec3 position_offset = packet.mesh->getPositionOffset();
+			glm::vec3 position_scale = packet.mesh->getPositionScale();
+			glUniform3f(uniforms.position_offset, position_offset.x, position_offset.y, position_offset.z);
+			glUniform3f(uniforms.position_scale, position_scale.x, position_scale.y, position_scale.z);
+			glUniform1i(uniforms.octahedral_normals, packet.mesh->isQuantized());
+			mesh = packet.mesh;
+		}
+
+		// Texture arrays are only bound when they differ from the ones on their unit, the atlas of
+		// a virtual texture takes the place of the plain texture
+		if(packet.textured) {
+			if(packet.virtual_texture) {
+				if(packet.virtual_texture != virtual_texture) {
+					packet.virtual_texture->bind(uniforms, 0, 2);
+					virtual_texture = packet.virtual_texture;
+					counts.texture_binds++;
+				}
+			}
+			else
+				counts.texture_binds += bindTextureArray(0, packet.texture_array);
+			counts.texture_binds += bindTextureArray(1, packet.normal_map_array);
+			if(!batched && (packet.texture_layer != texture_layer)) {
+				glUniform1i(uniforms.texture_layer, packet.texture_layer);
+				texture_layer = packet.texture_layer;
+			}
+			if(!batched && (packet.normal_map_layer != normal_map_layer)) {
+				glUniform1i(uniforms.normal_map_layer, packet.normal_map_layer);
+				normal_map_layer = packet.normal_map_layer;
+			}
+		}
+
+		if(packet.mesh->getVertexArray() != vertex_array) {
+			vertex_array = packet.mesh->getVertexArray();
+			glBindVertexArray(vertex_array);
+			counts.vertex_array_binds++;
+		}
+
+		if(batched) {
+			submitBatch(next, batch_end, counts);
+			next = batch_end;
+			continue;
+		}
+
+		// Draw call, every instance at once or meshlet by meshlet when the finest level is split
+		if(packet.instances) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instance_binding, packet.instances->getId());
+			packet.mesh->drawInstanced(packet.lod, packet.instances->getCount());
+			counts.instances += packet.instances->getCount();
+		}
+		else if((packet.lod == 0) && packet.mesh->hasMeshlets())
+			packet.mesh->drawMeshlets(packet.model, view, projection, counts.meshlets_drawn, counts.meshlets_culled);
+		else
+			packet.mesh->draw(packet.lod);
+		counts.drawn++;
+		counts.draw_calls++;
+		next++;
+	}
+
+	if(stats) {
+		stats->drawn += counts.drawn;
+		stats->instances += counts.instances;
+		stats->draw_calls += counts.draw_calls;
+		stats->meshlets_drawn += counts.meshlets_drawn;
+		stats->meshlets_culled += counts.meshlets_culled;
+		stats->program_switches += counts.program_switches;
+		stats->texture_binds += counts.texture_binds;
+		stats->vertex_array_binds += counts.vertex_array_binds;
+	}
+}
+
+void RenderQueue::submitBatch(size_t begin, size_t end, FrameStats& counts) {
+	commands.clear();
+	draw_data.clear();
+	for(size_t i = begin; i < end; i++) {
+		const DrawPacket& packet = packets[order[i].index];
+		size_t added = packet.mesh->appendCommands(packet.lod, packet.model, view, projection, commands, counts.meshlets_drawn, counts.meshlets_culled);
+
+		// gl_DrawID counts commands, a packet split in meshlet ranges repeats its data
+		DrawData data;
+		data.model = packet.model;
+		data.texture_layer = packet.texture_layer;
+		data.normal_map_layer = packet.normal_map_layer;
+		data.padding[0] = data.padding[1] = 0;
+		draw_data.insert(draw_data.end(), added, data);
+		counts.drawn++;
+	}
+	if(commands.empty())
+		return;
+
+	// Orphaned, the previous contents may still be read by the GPU
+	if(!command_buffer) {
+		glGenBuffers(1, &command_buffer);
+		glGenBuffers(1, &draw_data_buffer);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_data_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, draw_data.size() * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, draw_data.size() * sizeof(DrawData), draw_data.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, draw_data_binding, draw_data_buffer);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+	glMultiDrawElementsIndirect(GL_TRIANGLES, packets[order[begin].index].mesh->getIndexType(), nullptr, commands.size(), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	counts.draw_calls++;
+}
+
+RenderQueue::~RenderQueue() {
+	if(command_buffer) {
+		glDeleteBuffers(1, &command_buffer);
+		glDeleteBuffers(1, &draw_data_buffer);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "virtualTexture.hpp"
+#include "frameStats.hpp"
+#include "uniforms.hpp"
+#include "instances.hpp"
+
+// Everything a draw needs, gathered from the visible objects and lights before anything is submitted
+// The pointers only have to stay valid until the queue is submitted
+struct DrawPacket {
+	unsigned int program = 0;
+	const UniformLocations* uniforms = nullptr;
+
+	Mesh* mesh = nullptr;
+	unsigned int lod = 0;
+
+	// Texture arrays and layers, or the virtual texture taking the place of the plain texture
+	bool textured = false;
+	unsigned int texture_array = 0;
+	unsigned int normal_map_array = 0;
+	int texture_layer = 0;
+	int normal_map_layer = 0;
+	VirtualTexture* virtual_texture = nullptr;
+
+	// Drawn once per instance in a single draw when set, the model matrix then only places the packet in the queue
+	const InstanceBuffer* instances = nullptr;
+
+	// Drawn after every opaque packet, back to front
+	bool blended = false;
+
+	// Set when the program has a light_color uniform
+	glm::vec3 light_color = glm::vec3(1.0f);
+
+	glm::mat4 model = glm::mat4(1.0f);
+};
+
+// Binding of the DrawData shader storage block, read by indirect_shader.vert at gl_DrawID
+const unsigned int draw_data_binding = 2;
+
+// Per draw data of a multi draw, laid out like the std430 DrawData block of the shaders
+struct DrawData {
+	glm::mat4 model;
+	int32_t texture_layer;
+	int32_t normal_map_layer;
+	int32_t padding[2];
+};
+
+// Draws of a frame sorted by a 64 bit key, then submitted setting only the state that changed since the previous draw
+// Opaque key, high to low: pass, program, textures, vertex array, depth front to back
+// Blended key: pass, depth back to front, program, textures
+// GL names are truncated to their field, names sharing a field only lose some grouping
+// Consecutive packets of meshes in the same arena with the same index size, drawn by a program reading the DrawData
+// block with the same textures, are drawn in a single glMultiDrawElementsIndirect
+class RenderQueue {
+private:
+	struct SortEntry {
+		uint64_t key;
+		unsigned int index;
+	};
+
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+
+	// Kept between frames so gathering allocates nothing once the scene is loaded
+	std::vector<DrawPacket> packets;
+	std::vector<SortEntry> order;
+
+	// Commands and per draw data of the multi draws, rewritten for each one
+	std::vector<DrawCommand> commands;
+	std::vector<DrawData> draw_data;
+	unsigned int command_buffer = 0;
+	unsigned int draw_data_buffer = 0;
+
+	uint64_t makeKey(const DrawPacket& packet) const;
+
+	// Draw the sorted packets from begin to end in one multi draw, their shared state already set
+	void submitBatch(size_t begin, size_t end, FrameStats& counts);
+
+public:
+	RenderQueue() = default;
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// Start a frame seen through these matrices, dropping the packets of the previous one
+	void begin(const glm::mat4& view, const glm::mat4& projection);
+
+	void add(const DrawPacket& packet);
+
+	// Sort and draw every packet, counting the draws and state changes
+	void submit(FrameStats* stats = nullptr);
+
+	size_t size() const { return packets.size(); }
+
+	~RenderQueue();
+};
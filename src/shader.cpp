@@ -0,0 +1,121 @@
+#include "shader.hpp"
+#include "frameUniforms.hpp"
+
+#include <fstream>
+#include "glCalls.hpp"
+#include <iostream>
+#include <streambuf>
+#include <stdexcept>
+
+unsigned char ShaderProgram::load() {
+	// VERTEX
+	// Input vertex shader file to string 
+	std::ifstream vert_fstream(vertex_file);
+	const std::string vert_string((std::istreambuf_iterator<char>(vert_fstream)), (std::istreambuf_iterator<char>()));
+	if(vert_string.empty()){
+		throw std::runtime_error(std::string("Invalid vertex shader file: ")+vertex_file);
+		return -1;
+	}
+
+	// FRAGMENT
+	// Input fragment shader file to string 
+	std::ifstream frag_fstream(fragment_file);
+	const std::string frag_string((std::istreambuf_iterator<char>(frag_fstream)), (std::istreambuf_iterator<char>()));
+	if(frag_string.empty()){
+		throw std::runtime_error(std::string("Invalid fragment shader file: ")+fragment_file);
+		return -1;
+	}
+
+	return compile(vert_string, frag_string);
+}
+
+unsigned char ShaderProgram::compile(const std::string& vert_string, const std::string& frag_string) {
+	// Create and compile vertex shader
+	const char* vert_c_str = vert_string.c_str();
+	unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex_shader, 1 , &vert_c_str, nullptr);
+	glCompileShader(vertex_shader);
+
+	// Create and compile fragment shader
+	const char* frag_c_str = frag_string.c_str();
+	unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment_shader, 1 , &frag_c_str, nullptr);
+	glCompileShader(fragment_shader);
+
+	// Get compiler debug info
+	int vertex_debug_id, fragment_debug_id;
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vertex_debug_id);
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fragment_debug_id);
+	if(vertex_debug_id == GL_FALSE) {
+		int length;
+		glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &length);
+		std::string debug_log(length, '\0');
+		glGetShaderInfoLog(vertex_shader, length, &length, &debug_log[0]);
+
+		std::cout << "Vertex shader failed to compile: " << vertex_file << std::endl;
+		std::cout << debug_log << std::endl;
+	}
+	if(fragment_debug_id == GL_FALSE) {
+		int length;
+		glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &length);
+		std::string debug_log(length, '\0');
+		glGetShaderInfoLog(fragment_shader, length, &length, &debug_log[0]);
+
+		std::cout << "Fragment shader failed to compile: " << fragment_file << std::endl;
+		std::cout << debug_log << std::endl;
+	}
+	if((vertex_debug_id == GL_FALSE) || (fragment_debug_id == GL_FALSE)) {
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		throw std::runtime_error("Failed to compile shader");
+		return -1;
+	}
+
+	// Create program
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	glBindAttribLocation(program, 0, "position");
+	glBindAttribLocation(program, 1, "texture");
+	glBindAttribLocation(program, 2, "normal");
+	glLinkProgram(program);
+	int link_debug_id;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_debug_id);
+	if(link_debug_id == GL_FALSE) {
+		int length;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+		std::string debug_log(length, '\0');
+		glGetProgramInfoLog(program, length, &length, &debug_log[0]);
+
+		std::cout << "Program shader failed to link: " << fragment_file << std::endl;
+		std::cout << debug_log << std::endl;
+
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		glDeleteProgram(program);
+		throw std::runtime_error("Failed to link shader");
+		return -1;
+	}
+	glValidateProgram(program);
+
+	// Texture units, ignored by the programs not sampling them
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "texture_data"), 0);
+	glUniform1i(glGetUniformLocation(program, "normal_map_data"), 1);
+	glUniform1i(glGetUniformLocation(program, "page_table"), 2);
+	glUseProgram(0);
+	uniforms.resolve(program);
+	bindFrameBlock(program);
+
+	// Clean up, the program keeps them until deleted
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	id = program;
+	return 0;
+}
+
+ShaderProgram::~ShaderProgram() {
+	if(id)
+		glDeleteProgram(id);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+
+#include "uniforms.hpp"
+
+// Linked vertex and fragment shader pair with the locations of its uniforms
+// Shared through ShaderRegistry by every object and light using the same files, so their draws
+// need no program switch in between and can be batched into one multi draw
+class ShaderProgram {
+private:
+	std::string vertex_file;
+	std::string fragment_file;
+
+	unsigned int id = 0;
+	UniformLocations uniforms;
+
+public:
+	ShaderProgram(std::string vertex_file_path, std::string fragment_file_path) : vertex_file(vertex_file_path), fragment_file(fragment_file_path) {}
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+	// Read both files and compile at once
+	unsigned char load();
+
+	// Compile and link sources read elsewhere, binding the attribute, texture unit and FrameData locations
+	unsigned char compile(const std::string& vert_string, const std::string& frag_string);
+
+	// Zero until linked
+	unsigned int getId() const { return id; }
+	bool isReady() const { return id != 0; }
+	const UniformLocations& getUniforms() const { return uniforms; }
+
+	~ShaderProgram();
+};
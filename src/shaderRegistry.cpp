@@ -0,0 +1,34 @@
+#include "shaderRegistry.hpp"
+#include "assetLoader.hpp"
+#include "mappedFile.hpp"
+
+std::shared_ptr<ShaderProgram> ShaderRegistry::acquire(std::string vertex_file_path, std::string fragment_file_path, AssetLoader* loader) {
+	std::string key = canonicalPath(vertex_file_path) + " + " + canonicalPath(fragment_file_path);
+
+	std::shared_ptr<ShaderProgram> program = programs[key].lock();
+	if(program)
+		return program;
+
+	program = std::make_shared<ShaderProgram>(vertex_file_path, fragment_file_path);
+	if(loader)
+		loader->loadShader(vertex_file_path, fragment_file_path, [program](const std::string& vert_string, const std::string& frag_string) {
+			program->compile(vert_string, frag_string);
+		});
+	else
+		program->load();
+	programs[key] = program;
+	return program;
+}
+
+size_t ShaderRegistry::size() {
+	size_t alive = 0;
+	for(auto it = programs.begin(); it != programs.end();) {
+		if(it->second.expired())
+			it = programs.erase(it);
+		else {
+			alive++;
+			it++;
+		}
+	}
+	return alive;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "shader.hpp"
+
+class AssetLoader;
+
+// Programs shared between every object and light using the same shader files, keyed by their canonical paths
+// A program is compiled on its first use and deleted with its last user
+class ShaderRegistry {
+private:
+	std::unordered_map<std::string, std::weak_ptr<ShaderProgram>> programs;
+
+public:
+	ShaderRegistry() = default;
+	ShaderRegistry(const ShaderRegistry&) = delete;
+	ShaderRegistry& operator=(const ShaderRegistry&) = delete;
+
+	// Shared program of a vertex and fragment shader file pair
+	// With a loader the program is returned right away and compiled once both files are read in the background
+	std::shared_ptr<ShaderProgram> acquire(std::string vertex_file_path, std::string fragment_file_path, AssetLoader* loader = nullptr);
+
+	// Programs currently alive
+	size_t size();
+};
@@ -0,0 +1,225 @@
+#include "texture.hpp"
+
+#include "glCalls.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "stb_image.h"
+
+namespace {
+	GLenum compressedFormat(bc::Format format) {
+		switch(format) {
+			case bc::BC1:
+				return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			case bc::BC1A:
+				return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			case bc::BC3:
+				return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			case bc::BC7:
+				return GL_COMPRESSED_RGBA_BPTC_UNORM;
+			default:
+				return 0;
+		}
+	}
+
+	GLenum internalFormat(const ImageData& image) {
+		return image.isCompressed() ? compressedFormat(image.block_format) : ((image.channels == 4) ? GL_RGBA8 : GL_RGB8);
+	}
+
+	void setParameters() {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	size_t imageBytes(const ImageData& image) {
+		if(!image.hasLevels())
+			// The mip chain adds a third to the base level
+			return (size_t)image.width * image.height * image.channels * 4 / 3;
+		size_t bytes = 0;
+		for(const bc::Level& level : image.levels)
+			bytes += level.size;
+		return bytes;
+	}
+
+	bool imageHasAlpha(const ImageData& image) {
+		return image.isCompressed() ? (image.block_format != bc::BC1) : (image.channels == 4);
+	}
+
+	// Levels of a full chain down to 1x1
+	int levelCount(int width, int height) {
+		int count = 1;
+		while((width > 1) || (height > 1)) {
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+			count++;
+		}
+		return count;
+	}
+}
+
+
+Texture::~Texture() {
+	if(id)
+		glDeleteTextures(1, &id);
+	if(streaming_id)
+		glDeleteTextures(1, &streaming_id);
+	if(array)
+		array->release(layer);
+}
+
+void Texture::pack(const ImageData& image) {
+	if(!arrays)
+		return;
+	if(array)
+		array->release(layer);
+	int levels = image.hasLevels() ? image.levels.size() : levelCount(image.width, image.height);
+	array = arrays->add(id, image.width, image.height, internalFormat(image), levels, layer);
+	glDeleteTextures(1, &id);
+	id = 0;
+}
+
+unsigned char Texture::upload(const ImageData& image, std::string image_file_path) {
+	if(id)
+		glDeleteTextures(1, &id);
+	id = uploadTexture(image, image_file_path);
+	bytes = imageBytes(image);
+	alpha = imageHasAlpha(image);
+	pack(image);
+	return 0;
+}
+
+unsigned char Texture::allocate(const ImageData& image) {
+	if(streaming_id)
+		glDeleteTextures(1, &streaming_id);
+	glGenTextures(1, &streaming_id);
+	glBindTexture(GL_TEXTURE_2D, streaming_id);
+	setParameters();
+
+	// Immutable storage for every level, filled piece by piece
+	int levels = image.hasLevels() ? image.levels.size() : levelCount(image.width, image.height);
+	glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat(image), image.width, image.height);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return 0;
+}
+
+unsigned char Texture::uploadPiece(const ImageData& image, const TexturePiece& piece, size_t buffer_offset) {
+	glBindTexture(GL_TEXTURE_2D, streaming_id);
+	if(image.isCompressed())
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, piece.level, 0, piece.y, piece.width, piece.height, compressedFormat(image.block_format), piece.size, (const void*)buffer_offset);
+	else {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, piece.level, 0, piece.y, piece.width, piece.height, (image.channels == 4) ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, (const void*)buffer_offset);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return 0;
+}
+
+unsigned char Texture::finish(const ImageData& image) {
+	// Only the first level was streamed
+	if(!image.hasLevels()) {
+		glBindTexture(GL_TEXTURE_2D, streaming_id);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	if(id)
+		glDeleteTextures(1, &id);
+	id = streaming_id;
+	streaming_id = 0;
+	bytes = imageBytes(image);
+	alpha = imageHasAlpha(image);
+	pack(image);
+	return 0;
+}
+
+std::vector<TexturePiece> texturePieces(const ImageData& image, size_t max_size) {
+	std::vector<TexturePiece> pieces;
+	size_t level_count = image.hasLevels() ? image.levels.size() : 1;
+	for(size_t i = 0; i < level_count; i++) {
+		int width = image.hasLevels() ? image.levels[i].width : image.width;
+		int height = image.hasLevels() ? image.levels[i].height : image.height;
+		const unsigned char* data = image.hasLevels() ? image.levelData(i) : image.pixels;
+
+		// Compressed rows are rows of 4x4 blocks
+		int row_height = image.isCompressed() ? 4 : 1;
+		size_t row_size = image.isCompressed() ? bc::levelSize(image.block_format, width, 1) : (size_t)width * image.channels;
+		int row_count = (height + row_height - 1) / row_height;
+		if(row_size > max_size)
+			throw std::runtime_error(std::string("Texture rows of ")+std::to_string(row_size)+std::string(" bytes do not fit the upload buffer slots"));
+		int piece_rows = std::min<size_t>(max_size / row_size, row_count);
+		for(int row = 0; row < row_count; row += piece_rows) {
+			TexturePiece piece;
+			piece.level = i;
+			piece.y = row * row_height;
+			piece.width = width;
+			piece.height = std::min((row + piece_rows) * row_height, height) - piece.y;
+			piece.source = data + (size_t)row * row_size;
+			piece.size = (size_t)std::min(piece_rows, row_count - row) * row_size;
+			pieces.push_back(piece);
+		}
+	}
+	return pieces;
+}
+
+unsigned int uploadTexture(const ImageData& image, std::string image_file_path) {
+	// Generate and bind OpenGL texture
+	unsigned int texture_id;
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+
+	// Texture settings
+	setParameters();
+
+	// Pass the stored mip chain as is
+	if(image.isCompressed()) {
+		GLenum format = compressedFormat(image.block_format);
+		for(size_t i = 0; i < image.levels.size(); i++)
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, format, image.levels[i].width, image.levels[i].height, 0, image.levels[i].size, image.levelData(i));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture_id;
+	}
+
+	// Baked mip chain, rows of the small levels are not 4 byte aligned
+	if(image.hasLevels()) {
+		GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for(size_t i = 0; i < image.levels.size(); i++)
+			glTexImage2D(GL_TEXTURE_2D, i, (image.channels == 4) ? GL_RGBA8 : GL_RGB8, image.levels[i].width, image.levels[i].height, 0, format, GL_UNSIGNED_BYTE, image.levelData(i));
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture_id;
+	}
+
+	// Pass data
+	switch(image.channels) {
+		case 3:
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+			break;
+		case 4:
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+			break;
+		default:
+			glDeleteTextures(1, &texture_id);
+			throw std::runtime_error(std::string("Invalid number of channels [")+std::to_string(image.channels)+std::string("] in file: ")+image_file_path);
+			return 0;
+			break;
+	}
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// Unbind
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return texture_id;
+}
+
+unsigned char loadTexture(std::string image_file_path, Texture& texture, const TextureSettings& settings) {
+	stbi_set_flip_vertically_on_load(true);
+	ImageData image;
+	decodeImage(image_file_path, image, settings);
+	return texture.upload(image, image_file_path);
+}
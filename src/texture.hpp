@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "image.hpp"
+#include "textureArray.hpp"
+
+// Rows of one mip level, uploaded from a pixel unpack buffer in one call
+struct TexturePiece {
+	unsigned int level;
+	int y;
+	int width;
+	int height;
+	const unsigned char* source;
+	size_t size;
+};
+
+// OpenGL texture shared by every object using the same image file
+class Texture {
+private:
+	unsigned int id = 0;
+	size_t bytes = 0;
+	bool alpha = false;
+
+	// Texture being streamed, it replaces id once complete
+	unsigned int streaming_id = 0;
+
+	// Layer holding the texture once copied into an array, which then replaces id
+	TextureArrays* arrays = nullptr;
+	std::shared_ptr<TextureArray> array;
+	int layer = -1;
+
+	// Move the uploaded texture into the array of its size and format
+	void pack(const ImageData& image);
+
+public:
+	Texture() = default;
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	~Texture();
+
+	// Create the OpenGL texture, replacing any previous one
+	unsigned char upload(const ImageData& image, std::string image_file_path);
+
+	// Streamed upload: allocate every level, upload each piece from the bound pixel unpack buffer,
+	// then finish to build the missing mip levels and start using it
+	unsigned char allocate(const ImageData& image);
+	unsigned char uploadPiece(const ImageData& image, const TexturePiece& piece, size_t buffer_offset);
+	unsigned char finish(const ImageData& image);
+
+	// Pack the texture into one of these arrays once uploaded, they must outlive the upload
+	void setArrays(TextureArrays* texture_arrays) { arrays = texture_arrays; }
+
+	// Zero until uploaded, binding it then samples black
+	// A packed texture has no id of its own, it is sampled from its array at its layer
+	unsigned int getId() const { return id; }
+	unsigned int getArrayId() const { return array ? array->getId() : 0; }
+	int getLayer() const { return std::max(layer, 0); }
+	bool isUploaded() const { return (id != 0) || array; }
+
+	// Has an alpha channel, objects using it are blended
+	bool hasAlpha() const { return alpha; }
+
+	// Video memory used by all mip levels
+	size_t getBytes() const { return bytes; }
+};
+
+// Create a mipmapped, repeating 2D texture from a decoded image
+// Block compressed and baked images are uploaded with the mip levels they hold
+unsigned int uploadTexture(const ImageData& image, std::string image_file_path);
+
+// Split the levels to upload into pieces of at most max_size bytes, whole rows each
+std::vector<TexturePiece> texturePieces(const ImageData& image, size_t max_size);
+
+// Decode and upload at once
+unsigned char loadTexture(std::string image_file_path, Texture& texture, const TextureSettings& settings = TextureSettings());
@@ -0,0 +1,113 @@
+#include "textureArray.hpp"
+
+#include "glCalls.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+	// Array bound to each texture unit, as far as bindTextureArray knows
+	const unsigned int max_units = 16;
+	const unsigned int unknown = ~0u;
+	unsigned int bound_arrays[max_units] = {unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown,
+		unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown};
+}
+
+TextureArray::TextureArray(int width, int height, unsigned int format, int levels) : width(width), height(height), format(format), levels(levels) {
+}
+
+TextureArray::~TextureArray() {
+	if(id)
+		glDeleteTextures(1, &id);
+	resetTextureArrayBindings();
+}
+
+bool TextureArray::matches(int width, int height, unsigned int format, int levels) const {
+	return (this->width == width) && (this->height == height) && (this->format == format) && (this->levels == levels);
+}
+
+void TextureArray::grow() {
+	size_t layers = std::max<size_t>(used.size() * 2, 1);
+	unsigned int new_id;
+	glGenTextures(1, &new_id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, new_id);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, format, width, height, layers);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	resetTextureArrayBindings();
+
+	// Copied on the GPU, level by level
+	if(id) {
+		for(size_t layer = 0; layer < used.size(); layer++) {
+			if(!used[layer])
+				continue;
+			for(int level = 0; level < levels; level++)
+				glCopyImageSubData(id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, new_id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+					std::max(width >> level, 1), std::max(height >> level, 1), 1);
+		}
+		glDeleteTextures(1, &id);
+	}
+	id = new_id;
+	used.resize(layers, false);
+}
+
+int TextureArray::add(unsigned int texture_id) {
+	std::vector<bool>::iterator free_layer = std::find(used.begin(), used.end(), false);
+	if(free_layer == used.end()) {
+		grow();
+		free_layer = std::find(used.begin(), used.end(), false);
+	}
+	int layer = free_layer - used.begin();
+	used[layer] = true;
+
+	for(int level = 0; level < levels; level++)
+		glCopyImageSubData(texture_id, GL_TEXTURE_2D, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+			std::max(width >> level, 1), std::max(height >> level, 1), 1);
+	return layer;
+}
+
+void TextureArray::release(int layer) {
+	if((layer >= 0) && ((size_t)layer < used.size()))
+		used[layer] = false;
+}
+
+size_t TextureArray::layerCount() const {
+	return std::count(used.begin(), used.end(), true);
+}
+
+std::shared_ptr<TextureArray> TextureArrays::add(unsigned int texture_id, int width, int height, unsigned int format, int levels, int& layer) {
+	std::shared_ptr<TextureArray> array;
+	for(std::shared_ptr<TextureArray>& candidate : arrays)
+		if(candidate->matches(width, height, format, levels)) {
+			array = candidate;
+			break;
+		}
+	if(!array) {
+		array = std::make_shared<TextureArray>(width, height, format, levels);
+		arrays.push_back(array);
+	}
+	layer = array->add(texture_id);
+	return array;
+}
+
+void TextureArrays::printUsage() const {
+	std::cout << "Texture arrays: " << arrays.size() << std::endl;
+	for(const std::shared_ptr<TextureArray>& array : arrays)
+		std::cout << "\t" << array->getWidth() << "x" << array->getHeight() << ": " << array->layerCount() << " of " << array->capacity() << " layers" << std::endl;
+}
+
+bool bindTextureArray(unsigned int unit, unsigned int array_id) {
+	if((unit < max_units) && (bound_arrays[unit] == array_id))
+		return false;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array_id);
+	if(unit < max_units)
+		bound_arrays[unit] = array_id;
+	return true;
+}
+
+void resetTextureArrayBindings() {
+	std::fill(bound_arrays, bound_arrays + max_units, unknown);
+}
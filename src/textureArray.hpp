@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+// Textures of the same size, format and level count stored as the layers of one GL_TEXTURE_2D_ARRAY
+// Objects drawn one after the other then keep the same texture bound and only change a layer uniform
+class TextureArray {
+private:
+	unsigned int id = 0;
+	int width;
+	int height;
+	unsigned int format;
+	int levels;
+
+	// Layers holding a texture, the others are reused before growing
+	std::vector<bool> used;
+
+	// Reallocate with twice the layers, copying the used ones
+	void grow();
+
+public:
+	TextureArray(int width, int height, unsigned int format, int levels);
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	~TextureArray();
+
+	bool matches(int width, int height, unsigned int format, int levels) const;
+
+	// Copy every level of a 2D texture into a free layer and return it
+	int add(unsigned int texture_id);
+	void release(int layer);
+
+	// Changes when the array grows
+	unsigned int getId() const { return id; }
+
+	size_t layerCount() const;
+	size_t capacity() const { return used.size(); }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+};
+
+// Every texture array of the scene, one per size and format in use
+class TextureArrays {
+private:
+	std::vector<std::shared_ptr<TextureArray>> arrays;
+
+public:
+	// Copy a texture into the array of its size and format, creating it on first use
+	std::shared_ptr<TextureArray> add(unsigned int texture_id, int width, int height, unsigned int format, int levels, int& layer);
+
+	size_t size() const { return arrays.size(); }
+
+	// Print every array with its size and layers in use
+	void printUsage() const;
+};
+
+// Bind an array to a texture unit unless it is bound there already, true when a bind was issued
+bool bindTextureArray(unsigned int unit, unsigned int array_id);
+
+// Forget which arrays are bound, after binding GL_TEXTURE_2D_ARRAY directly
+void resetTextureArrayBindings();
@@ -0,0 +1,153 @@
+#include "textureCache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+	// Levels follow the header without padding, every one down to 1x1
+	void cacheLevels(const btex::Header& header, ImageData& image) {
+		image.levels.clear();
+		size_t offset = sizeof(btex::Header);
+		int width = header.width;
+		int height = header.height;
+		for(uint32_t i = 0; i < header.level_count; i++) {
+			bc::Level level;
+			level.width = width;
+			level.height = height;
+			level.offset = offset;
+			level.size = (size_t)width * height * header.channels;
+			image.levels.push_back(level);
+			offset += level.size;
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+	}
+
+	uint32_t levelCount(uint32_t width, uint32_t height) {
+		uint32_t count = 1;
+		while((width > 1) || (height > 1)) {
+			width = std::max<uint32_t>(width / 2, 1);
+			height = std::max<uint32_t>(height / 2, 1);
+			count++;
+		}
+		return count;
+	}
+}
+
+std::string btex::cachePath(std::string image_file_path, const TextureSettings& settings) {
+	return image_file_path + ((settingsFlags(settings) & NORMAL_MAP) ? ".normal.btex" : ".btex");
+}
+
+uint32_t btex::settingsFlags(const TextureSettings& settings) {
+	uint32_t flags = 0;
+	if(settings.normal_map)
+		flags |= NORMAL_MAP;
+	return flags;
+}
+
+bool btex::open(std::string image_file_path, ImageData& image, const TextureSettings& settings) {
+	SourceInfo source;
+	if(!getSourceInfo(image_file_path, source))
+		return false;
+	std::string cache_path = cachePath(image_file_path, settings);
+	SourceInfo cache;
+	if(!getSourceInfo(cache_path, cache) || (cache.size < sizeof(Header)))
+		return false;
+
+	MappedFile& cache_file = image.mapped;
+	try {
+		cache_file.open(cache_path);
+	}
+	catch(const std::runtime_error&) {
+		return false;
+	}
+
+	const Header* header = (const Header*)cache_file.data();
+	if((memcmp(header->magic, magic, sizeof(magic)) != 0) || (header->version != version) || (header->flags != settingsFlags(settings)) ||
+		((header->channels != 3) && (header->channels != 4)) || (header->width == 0) || (header->height == 0) ||
+		(header->level_count != levelCount(header->width, header->height))) {
+		cache_file.close();
+		return false;
+	}
+	cacheLevels(*header, image);
+	if(cache_file.size() != image.levels.back().offset + image.levels.back().size) {
+		image.levels.clear();
+		cache_file.close();
+		return false;
+	}
+
+	// Same size and time means the same source, otherwise fall back to comparing contents
+	if((header->source_size != source.size) || ((header->source_mtime != source.mtime) && (header->source_hash != hashFile(image_file_path)))) {
+		image.levels.clear();
+		cache_file.close();
+		return false;
+	}
+	if(header->source_mtime != source.mtime) {
+		// Only touched, store the new time so the next launch skips hashing
+		std::fstream cache_stream(cache_path, std::fstream::binary | std::fstream::in | std::fstream::out);
+		cache_stream.seekp(offsetof(Header, source_mtime));
+		cache_stream.write((const char*)&source.mtime, sizeof(source.mtime));
+	}
+
+	image.width = header->width;
+	image.height = header->height;
+	image.channels = header->channels;
+	return true;
+}
+
+bool btex::write(std::string image_file_path, const ImageData& image, const TextureSettings& settings) {
+	SourceInfo source;
+	if(!getSourceInfo(image_file_path, source))
+		return false;
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.source_hash = hashFile(image_file_path);
+	header.width = image.width;
+	header.height = image.height;
+	header.channels = image.channels;
+	header.flags = settingsFlags(settings);
+	header.level_count = image.levels.size();
+
+	// Write to a temporary file of this thread and rename, so neither a crash nor another writer leaves a truncated cache behind
+	std::string cache_path = cachePath(image_file_path, settings);
+	std::string temp_path = temporaryPath(cache_path);
+	std::ofstream cache_stream(temp_path, std::ofstream::binary | std::ofstream::trunc);
+	if(!cache_stream.good())
+		return false;
+	cache_stream.write((const char*)&header, sizeof(header));
+	cache_stream.write((const char*)image.level_data.data(), image.level_data.size());
+	cache_stream.close();
+	if(!cache_stream.good() || (rename(temp_path.c_str(), cache_path.c_str()) != 0)) {
+		remove(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+unsigned char btex::read(std::string image_file_path, ImageData& image, const TextureSettings& settings) {
+	if(open(image_file_path, image, settings))
+		return 0;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	TextureSettings decode_settings = settings;
+	decode_settings.cache = false;
+	decodeImage(image_file_path, image, decode_settings);
+	generateMips(image, settings.normal_map);
+	if(!write(image_file_path, image, settings))
+		std::cout << "Texture " << image_file_path << ": could not write " << cachePath(image_file_path, settings) << std::endl;
+	std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Texture " << image_file_path << ": " << image.width << "x" << image.height << ", " << image.levels.size() << " levels baked in " << span.count() << " ms" << std::endl;
+
+	return 0;
+}
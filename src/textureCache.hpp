@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+
+#include "image.hpp"
+#include "mappedFile.hpp"
+
+// Baked texture cache, stored next to the source image with the .btex extension, one file per set of flags
+// Layout: Header, then every mip level from the full size one down to 1x1, 8 bit RGB or RGBA rows bottom to top
+namespace btex {
+	const char magic[4] = {'B', 'T', 'E', 'X'};
+	const uint32_t version = 1;
+
+	// Filtering of the cached mip chain, a cache built with other settings is rebuilt
+	enum flags {
+		NORMAL_MAP = 1 << 0
+	};
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t source_size;
+		int64_t source_mtime;
+		uint64_t source_hash;
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t flags;
+		uint32_t level_count;
+		uint32_t padding;
+	};
+
+	// earth.jpg -> earth.jpg.btex, or earth.jpg.normal.btex when baked as a normal map, so images differing only by
+	// extension and the variants of one image do not share it
+	std::string cachePath(std::string image_file_path, const TextureSettings& settings);
+
+	// Flags matching the filtering enabled in the settings
+	uint32_t settingsFlags(const TextureSettings& settings);
+
+	// Map the cache of an image into its levels, false if missing, corrupt, older than the source or built with other settings
+	bool open(std::string image_file_path, ImageData& image, const TextureSettings& settings);
+
+	// Write the cache of an image with its mip chain, false if the directory is not writable
+	bool write(std::string image_file_path, const ImageData& image, const TextureSettings& settings);
+
+	// Map an image from its cache when valid, otherwise decode it, build the mip chain and refresh the cache
+	// Does not touch OpenGL, safe to call from worker threads
+	unsigned char read(std::string image_file_path, ImageData& image, const TextureSettings& settings);
+}
@@ -0,0 +1,122 @@
+#include "textureRegistry.hpp"
+#include "assetLoader.hpp"
+#include "threadPool.hpp"
+#include "mappedFile.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+	// Normal maps are filtered differently, an image used as both gets two textures
+	std::string textureKey(std::string image_file_path, const TextureSettings& settings) {
+		return canonicalPath(image_file_path) + (settings.normal_map ? std::string(" (normal map)") : std::string());
+	}
+}
+
+std::shared_ptr<Texture> TextureRegistry::acquire(std::string image_file_path, const TextureSettings& settings, AssetLoader* loader) {
+	std::string key = textureKey(image_file_path, settings);
+
+	std::shared_ptr<Texture> texture = textures[key].lock();
+	if(texture)
+		return texture;
+
+	texture = std::make_shared<Texture>();
+	texture->setArrays(&arrays);
+	if(loader)
+		loader->loadTexture(image_file_path, texture, settings);
+	else
+		loadTexture(image_file_path, *texture, settings);
+	textures[key] = texture;
+	return texture;
+}
+
+std::vector<std::shared_ptr<Texture>> TextureRegistry::preload(const std::vector<std::string>& image_file_paths, const std::vector<TextureSettings>& settings, ThreadPool* pool) {
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	// Each file once, skipping the ones already shared
+	std::vector<std::shared_ptr<Texture>> preloaded;
+	std::vector<std::string> paths;
+	std::vector<TextureSettings> path_settings;
+	std::vector<std::string> keys;
+	for(size_t i = 0; i < image_file_paths.size(); i++) {
+		if(image_file_paths[i].empty())
+			continue;
+		std::string key = textureKey(image_file_paths[i], settings[i]);
+		std::shared_ptr<Texture> texture = textures[key].lock();
+		if(texture) {
+			preloaded.push_back(texture);
+			continue;
+		}
+		texture = std::make_shared<Texture>();
+		texture->setArrays(&arrays);
+		textures[key] = texture;
+		preloaded.push_back(texture);
+		paths.push_back(image_file_paths[i]);
+		path_settings.push_back(settings[i]);
+		keys.push_back(key);
+	}
+	if(paths.empty())
+		return preloaded;
+
+	// Largest files first, so the longest decode does not start last
+	std::vector<size_t> order(paths.size());
+	std::vector<off_t> file_sizes(paths.size(), 0);
+	for(size_t i = 0; i < paths.size(); i++) {
+		order[i] = i;
+		struct stat file_stat;
+		if(stat(paths[i].c_str(), &file_stat) == 0)
+			file_sizes[i] = file_stat.st_size;
+	}
+	std::stable_sort(order.begin(), order.end(), [&file_sizes](size_t a, size_t b) { return file_sizes[a] > file_sizes[b]; });
+
+	// Decoding only touches the images, OpenGL stays on this thread
+	stbi_set_flip_vertically_on_load(true);
+	std::vector<ImageData> images(paths.size());
+	if(pool)
+		pool->parallelFor(paths.size(), [&](size_t i) { decodeImage(paths[order[i]], images[order[i]], path_settings[order[i]]); });
+	else
+		for(size_t i = 0; i < paths.size(); i++)
+			decodeImage(paths[i], images[i], path_settings[i]);
+	std::chrono::duration<float, std::milli> decode_span = std::chrono::high_resolution_clock::now() - start;
+
+	for(size_t i = 0; i < paths.size(); i++)
+		textures[keys[i]].lock()->upload(images[i], paths[i]);
+
+	std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Textures: " << paths.size() << " decoded in " << decode_span.count() << " ms on " << (pool ? std::min<size_t>(paths.size(), pool->size() + 1) : 1) << " threads, uploaded in " << span.count() - decode_span.count() << " ms" << std::endl;
+	return preloaded;
+}
+
+size_t TextureRegistry::size() {
+	size_t alive = 0;
+	for(auto it = textures.begin(); it != textures.end();) {
+		if(it->second.expired())
+			it = textures.erase(it);
+		else {
+			alive++;
+			it++;
+		}
+	}
+	return alive;
+}
+
+size_t TextureRegistry::residentBytes() {
+	size_t bytes = 0;
+	for(auto& entry : textures) {
+		std::shared_ptr<Texture> texture = entry.second.lock();
+		if(texture)
+			bytes += texture->getBytes();
+	}
+	return bytes;
+}
+
+void TextureRegistry::printUsage() {
+	std::cout << "Textures loaded: " << size() << ", " << residentBytes() / (1024.0f * 1024.0f) << " MB resident" << std::endl;
+	for(auto& entry : textures)
+		std::cout << "\t" << entry.first << ": " << entry.second.use_count() << " users" << std::endl;
+	arrays.printUsage();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "texture.hpp"
+
+class AssetLoader;
+class ThreadPool;
+
+// Textures shared between every object using the same image file, keyed by canonical path
+// An image is decoded and uploaded on its first use and released with its last user
+// Once uploaded, textures of the same size and format are packed together into texture arrays
+class TextureRegistry {
+private:
+	std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+	TextureArrays arrays;
+
+public:
+	TextureRegistry() = default;
+	TextureRegistry(const TextureRegistry&) = delete;
+	TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+	// Shared texture of an image file
+	// With a loader the texture is returned right away and uploaded once decoded in the background
+	std::shared_ptr<Texture> acquire(std::string image_file_path, const TextureSettings& settings = TextureSettings(), AssetLoader* loader = nullptr);
+
+	// Decode every image not loaded yet concurrently on the pool, then upload them on the calling thread
+	// settings holds the settings of each image
+	// The textures are only kept alive by the returned vector, later acquire calls share them
+	std::vector<std::shared_ptr<Texture>> preload(const std::vector<std::string>& image_file_paths, const std::vector<TextureSettings>& settings, ThreadPool* pool);
+
+	// Textures currently alive
+	size_t size();
+
+	// Video memory used by the alive textures
+	size_t residentBytes();
+
+	// Print every alive texture with its number of users and the resident total
+	void printUsage();
+};
@@ -0,0 +1,97 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+	if(thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	for(unsigned int i = 0; i < thread_count; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+void ThreadPool::work() {
+	while(true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobs_mutex);
+			jobs_condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if(stopping && jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+namespace {
+	struct ParallelForState {
+		std::function<void(size_t)> job;
+		size_t count;
+		std::atomic<size_t> next;
+		std::atomic<size_t> done;
+		std::mutex done_mutex;
+		std::condition_variable done_condition;
+		std::exception_ptr error;
+
+		// Take items until none is left, helpers may start after everything is done
+		void run() {
+			size_t i;
+			while((i = next.fetch_add(1)) < count) {
+				try {
+					job(i);
+				}
+				catch(...) {
+					std::lock_guard<std::mutex> lock(done_mutex);
+					if(!error)
+						error = std::current_exception();
+				}
+				if(done.fetch_add(1) + 1 == count) {
+					std::lock_guard<std::mutex> lock(done_mutex);
+					done_condition.notify_all();
+				}
+			}
+		}
+	};
+}
+
+void ThreadPool::parallelFor(size_t count, std::function<void(size_t)> job, unsigned int max_threads) {
+	if(count == 0)
+		return;
+
+	std::shared_ptr<ParallelForState> state(new ParallelForState());
+	state->job = job;
+	state->count = count;
+	state->next = 0;
+	state->done = 0;
+
+	size_t helpers = std::min<size_t>(count - 1, workers.size());
+	if(max_threads > 0)
+		helpers = std::min<size_t>(helpers, max_threads - 1);
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		for(size_t i = 0; i < helpers; i++)
+			jobs.push_back([state]() { state->run(); });
+	}
+	jobs_condition.notify_all();
+
+	state->run();
+	{
+		std::unique_lock<std::mutex> lock(state->done_mutex);
+		state->done_condition.wait(lock, [&state]() { return state->done == state->count; });
+	}
+	if(state->error)
+		std::rethrow_exception(state->error);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		stopping = true;
+	}
+	jobs_condition.notify_all();
+	for(size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a shared job queue
+class ThreadPool {
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobs_mutex;
+	std::condition_variable jobs_condition;
+	bool stopping = false;
+
+	void work();
+public:
+	// Zero uses one thread per hardware thread
+	ThreadPool(unsigned int thread_count = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int size() const { return workers.size(); }
+
+	template<typename F>
+	std::future<typename std::result_of<F()>::type> enqueue(F job) {
+		typedef typename std::result_of<F()>::type result_type;
+		std::shared_ptr<std::packaged_task<result_type()>> task(new std::packaged_task<result_type()>(job));
+		std::future<result_type> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(jobs_mutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		jobs_condition.notify_one();
+		return result;
+	}
+
+	// Run job(0) .. job(count-1) on at most max_threads threads, the caller takes part
+	// so it is safe to call from inside a job even when every worker is busy
+	void parallelFor(size_t count, std::function<void(size_t)> job, unsigned int max_threads = 0);
+
+	~ThreadPool();
+};
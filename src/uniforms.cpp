@@ -0,0 +1,18 @@
+#include "uniforms.hpp"
+#include "glCalls.hpp"
+
+void UniformLocations::resolve(unsigned int shader_program) {
+	model = glGetUniformLocation(shader_program, "model");
+	position_offset = glGetUniformLocation(shader_program, "position_offset");
+	position_scale = glGetUniformLocation(shader_program, "position_scale");
+	octahedral_normals = glGetUniformLocation(shader_program, "octahedral_normals");
+	light_color = glGetUniformLocation(shader_program, "light_color");
+	texture_layer = glGetUniformLocation(shader_program, "texture_layer");
+	normal_map_layer = glGetUniformLocation(shader_program, "normal_map_layer");
+	virtual_size = glGetUniformLocation(shader_program, "virtual_size");
+	tile_size = glGetUniformLocation(shader_program, "tile_size");
+	tile_border = glGetUniformLocation(shader_program, "tile_border");
+	atlas_size = glGetUniformLocation(shader_program, "atlas_size");
+	max_level = glGetUniformLocation(shader_program, "max_level");
+	draw_data = glGetProgramResourceIndex(shader_program, GL_SHADER_STORAGE_BLOCK, "DrawData") != GL_INVALID_INDEX;
+}
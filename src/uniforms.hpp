@@ -0,0 +1,32 @@
+#pragma once
+
+// Locations of the uniforms set on every draw, looked up once after linking
+// -1 for the ones a program does not use, which OpenGL silently ignores
+// The camera and scene light come from the FrameData block instead, see frameUniforms.hpp
+struct UniformLocations {
+	int model = -1;
+
+	// Vertex dequantization
+	int position_offset = -1;
+	int position_scale = -1;
+	int octahedral_normals = -1;
+
+	// Color of a light, drawn by its own program
+	int light_color = -1;
+
+	// Layers of the texture arrays
+	int texture_layer = -1;
+	int normal_map_layer = -1;
+
+	// Virtual texture sampling
+	int virtual_size = -1;
+	int tile_size = -1;
+	int tile_border = -1;
+	int atlas_size = -1;
+	int max_level = -1;
+
+	// Reads the model matrix and texture layers from the DrawData block at gl_DrawID, see RenderQueue
+	bool draw_data = false;
+
+	void resolve(unsigned int shader_program);
+};
@@ -0,0 +1,64 @@
+#include "uploadRing.hpp"
+
+#include "glCalls.hpp"
+#include <stdexcept>
+
+UploadRing::UploadRing(size_t size, unsigned int slot_count) {
+	slot_size = size / slot_count;
+	fences.resize(slot_count, nullptr);
+	acquired.resize(slot_count, false);
+
+	// Coherent, so writes from the workers need no flush before the upload
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, slot_size * slot_count, nullptr, flags);
+	mapping = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slot_size * slot_count, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if(!mapping) {
+		glDeleteBuffers(1, &buffer);
+		throw std::runtime_error("Failed to map the texture upload buffer");
+	}
+}
+
+int UploadRing::acquire() {
+	for(unsigned int i = 0; i < fences.size(); i++) {
+		unsigned int slot = (next + i) % fences.size();
+		if(acquired[slot])
+			continue;
+		if(fences[slot]) {
+			GLenum status = glClientWaitSync((GLsync)fences[slot], 0, 0);
+			if((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+				continue;
+			glDeleteSync((GLsync)fences[slot]);
+			fences[slot] = nullptr;
+		}
+		acquired[slot] = true;
+		next = (slot + 1) % fences.size();
+		return slot;
+	}
+	return -1;
+}
+
+void UploadRing::release(int slot) {
+	fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	acquired[slot] = false;
+}
+
+void UploadRing::bind() const {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+}
+
+void UploadRing::unbind() const {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadRing::~UploadRing() {
+	for(void* fence : fences)
+		if(fence)
+			glDeleteSync((GLsync)fence);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+// Persistently mapped pixel unpack buffer split into equal slots
+// Any thread may write into an acquired slot, the render thread then reads it into a texture
+// and fences it: the slot is handed out again once the GPU is done reading it
+class UploadRing {
+private:
+	unsigned int buffer = 0;
+	unsigned char* mapping = nullptr;
+	size_t slot_size = 0;
+
+	// Fence of each slot read by the GPU, null when free or still being written
+	std::vector<void*> fences;
+	std::vector<bool> acquired;
+	unsigned int next = 0;
+
+public:
+	UploadRing(size_t size, unsigned int slot_count);
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	// Next slot the GPU is done with, -1 when every slot is in use
+	int acquire();
+
+	// Fence the reads issued from the slot since bind(), it is reused once they complete
+	void release(int slot);
+
+	unsigned char* data(int slot) const { return mapping + (size_t)slot * slot_size; }
+	size_t offset(int slot) const { return (size_t)slot * slot_size; }
+	size_t slotSize() const { return slot_size; }
+
+	// Source of the texture uploads issued until unbind()
+	void bind() const;
+	void unbind() const;
+
+	~UploadRing();
+};
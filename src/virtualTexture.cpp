@@ -0,0 +1,444 @@
+#include "virtualTexture.hpp"
+#include "frustum.hpp"
+#include "image.hpp"
+
+#include "glCalls.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+#include "stb_image.h"
+
+namespace {
+	const float pi = 3.14159265358979f;
+
+	uint32_t nextPowerOfTwo(uint32_t value) {
+		uint32_t power = 1;
+		while(power < value)
+			power *= 2;
+		return power;
+	}
+
+	// Enough levels for the coarsest to be a single row or column of tiles
+	uint32_t levelCount(uint32_t tiles_x, uint32_t tiles_y) {
+		uint32_t count = 1;
+		while((tiles_x > 1) || (tiles_y > 1)) {
+			tiles_x = std::max<uint32_t>(tiles_x / 2, 1);
+			tiles_y = std::max<uint32_t>(tiles_y / 2, 1);
+			count++;
+		}
+		return count;
+	}
+
+	size_t tileCount(const vtex::Header& header) {
+		size_t count = 0;
+		for(uint32_t level = 0; level < header.level_count; level++)
+			count += (size_t)std::max(header.tiles_x >> level, 1u) * std::max(header.tiles_y >> level, 1u);
+		return count;
+	}
+
+	size_t tileBytes(const vtex::Header& header) {
+		size_t side = header.tile_size + 2 * header.border;
+		return side * side * 3;
+	}
+
+	// Bilinear resampling of RGB pixels, wrapping around horizontally like longitudes and clamped vertically
+	void resample(const unsigned char* pixels, int width, int height, int channels, int new_width, int new_height, std::vector<unsigned char>& resampled) {
+		resampled.resize((size_t)new_width * new_height * 3);
+		for(int y = 0; y < new_height; y++) {
+			float source_y = std::min(std::max((y + 0.5f) * height / new_height - 0.5f, 0.0f), (float)(height - 1));
+			int y0 = (int)source_y;
+			int y1 = std::min(y0 + 1, height - 1);
+			float fy = source_y - y0;
+			for(int x = 0; x < new_width; x++) {
+				float source_x = (x + 0.5f) * width / new_width - 0.5f;
+				int x0 = (int)floorf(source_x);
+				float fx = source_x - x0;
+				x0 = (x0 + width) % width;
+				int x1 = (x0 + 1) % width;
+				for(int c = 0; c < 3; c++) {
+					float top = pixels[((size_t)y0 * width + x0) * channels + c] * (1.0f - fx) + pixels[((size_t)y0 * width + x1) * channels + c] * fx;
+					float bottom = pixels[((size_t)y1 * width + x0) * channels + c] * (1.0f - fx) + pixels[((size_t)y1 * width + x1) * channels + c] * fx;
+					resampled[((size_t)y * new_width + x) * 3 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+	}
+
+	// Point of the unit sphere at texture coordinates u, v, the inverse of the procedural sphere mapping
+	glm::vec3 spherePoint(float u, float v) {
+		float longitude = u * 2.0f * pi - pi;
+		float latitude = (v - 0.5f) * pi;
+		return glm::vec3(cosf(latitude) * sinf(longitude), sinf(latitude), cosf(latitude) * cosf(longitude));
+	}
+
+	uint32_t pageEntry(unsigned int slot_x, unsigned int slot_y, unsigned int level) {
+		return slot_x | (slot_y << 8) | (level << 16) | (255u << 24);
+	}
+}
+
+std::string vtex::cachePath(std::string image_file_path) {
+	return image_file_path + ".vtex";
+}
+
+bool vtex::open(std::string image_file_path, MappedFile& cache_file, unsigned int tile_size) {
+	SourceInfo source;
+	if(!getSourceInfo(image_file_path, source))
+		return false;
+	std::string cache_path = cachePath(image_file_path);
+	SourceInfo cache;
+	if(!getSourceInfo(cache_path, cache) || (cache.size < sizeof(Header)))
+		return false;
+
+	try {
+		cache_file.open(cache_path);
+	}
+	catch(const std::runtime_error&) {
+		return false;
+	}
+
+	const Header* header = (const Header*)cache_file.data();
+	if((memcmp(header->magic, magic, sizeof(magic)) != 0) || (header->version != version) || (header->tile_size != tile_size) ||
+		(header->border != border) || (header->tiles_x == 0) || (header->tiles_y == 0) ||
+		(header->level_count != levelCount(header->tiles_x, header->tiles_y)) ||
+		(cache_file.size() != sizeof(Header) + tileCount(*header) * tileBytes(*header))) {
+		cache_file.close();
+		return false;
+	}
+
+	// Same size and time means the same source, otherwise fall back to comparing contents
+	if((header->source_size != source.size) || ((header->source_mtime != source.mtime) && (header->source_hash != hashFile(image_file_path)))) {
+		cache_file.close();
+		return false;
+	}
+	if(header->source_mtime != source.mtime) {
+		// Only touched, store the new time so the next launch skips hashing
+		std::fstream cache_stream(cache_path, std::fstream::binary | std::fstream::in | std::fstream::out);
+		cache_stream.seekp(offsetof(Header, source_mtime));
+		cache_stream.write((const char*)&source.mtime, sizeof(source.mtime));
+	}
+
+	return true;
+}
+
+bool vtex::write(std::string image_file_path, unsigned int tile_size) {
+	SourceInfo source;
+	if(!getSourceInfo(image_file_path, source))
+		return false;
+
+	ImageData image;
+	decodeImage(image_file_path, image);
+	if(image.isCompressed())
+		throw std::runtime_error(std::string("Virtual textures need a jpg/png image: ")+image_file_path);
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.source_hash = hashFile(image_file_path);
+	header.tiles_x = nextPowerOfTwo((image.width + tile_size - 1) / tile_size);
+	header.tiles_y = nextPowerOfTwo((image.height + tile_size - 1) / tile_size);
+	header.tile_size = tile_size;
+	header.border = border;
+	header.level_count = levelCount(header.tiles_x, header.tiles_y);
+
+	// Stretched to whole tiles at every level, the texture coordinates still span the image
+	std::vector<unsigned char> pixels;
+	resample(image.pixels, image.width, image.height, image.channels, header.tiles_x * tile_size, header.tiles_y * tile_size, pixels);
+	stbi_image_free(image.pixels);
+	image.pixels = nullptr;
+	std::vector<unsigned char> level_data;
+	std::vector<bc::Level> levels;
+	buildMipChain(pixels.data(), header.tiles_x * tile_size, header.tiles_y * tile_size, 3, false, level_data, levels);
+	pixels.clear();
+	pixels.shrink_to_fit();
+
+	// Write to a temporary file of this thread and rename, so neither a crash nor another writer leaves a truncated cache behind
+	std::string cache_path = cachePath(image_file_path);
+	std::string temp_path = temporaryPath(cache_path);
+	std::ofstream cache_stream(temp_path, std::ofstream::binary | std::ofstream::trunc);
+	if(!cache_stream.good())
+		return false;
+	cache_stream.write((const char*)&header, sizeof(header));
+
+	int side = tile_size + 2 * border;
+	std::vector<unsigned char> tile(tileBytes(header));
+	for(uint32_t level = 0; level < header.level_count; level++) {
+		const bc::Level& mip = levels[level];
+		const unsigned char* mip_pixels = &level_data[mip.offset];
+		unsigned int tiles_x = std::max(header.tiles_x >> level, 1u);
+		unsigned int tiles_y = std::max(header.tiles_y >> level, 1u);
+		for(unsigned int tile_y = 0; tile_y < tiles_y; tile_y++)
+			for(unsigned int tile_x = 0; tile_x < tiles_x; tile_x++) {
+				// Borders come from the neighbouring tiles, across the date line too
+				for(int row = 0; row < side; row++) {
+					int y = std::min(std::max((int)(tile_y * tile_size) + row - (int)border, 0), mip.height - 1);
+					for(int column = 0; column < side; column++) {
+						int x = ((int)(tile_x * tile_size) + column - (int)border + mip.width) % mip.width;
+						memcpy(&tile[((size_t)row * side + column) * 3], &mip_pixels[((size_t)y * mip.width + x) * 3], 3);
+					}
+				}
+				cache_stream.write((const char*)tile.data(), tile.size());
+			}
+	}
+	cache_stream.close();
+	if(!cache_stream.good() || (rename(temp_path.c_str(), cache_path.c_str()) != 0)) {
+		remove(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+unsigned char VirtualTexture::open(std::string image_file_path, const VirtualTextureSettings& settings) {
+	this->settings = settings;
+	if(!vtex::open(image_file_path, file, settings.tile_size)) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if(!vtex::write(image_file_path, settings.tile_size) || !vtex::open(image_file_path, file, settings.tile_size)) {
+			throw std::runtime_error(std::string("Could not write virtual texture tiles: ")+vtex::cachePath(image_file_path));
+			return -1;
+		}
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Virtual texture " << image_file_path << ": tiles baked in " << span.count() << " ms" << std::endl;
+	}
+	header = *(const vtex::Header*)file.data();
+
+	level_first_tile.clear();
+	size_t first = 0;
+	for(unsigned int level = 0; level < header.level_count; level++) {
+		level_first_tile.push_back(first);
+		first += (size_t)tilesX(level) * tilesY(level);
+	}
+	std::cout << "Virtual texture " << image_file_path << ": " << header.tiles_x * header.tile_size << "x" << header.tiles_y * header.tile_size
+		<< ", " << first << " tiles of " << header.tile_size << " in " << header.level_count << " levels" << std::endl;
+
+	return 0;
+}
+
+unsigned char VirtualTexture::create() {
+	unsigned int top_level = header.level_count - 1;
+	unsigned int top_tiles = tilesX(top_level) * tilesY(top_level);
+	// Atlas slots are stored in the 8 bit page table channels
+	slots_per_side = std::min(std::max((unsigned int)ceilf(sqrtf((float)std::max(settings.cache_tiles, top_tiles + 1))), 1u), 256u);
+	unsigned int slot_count = slots_per_side * slots_per_side;
+	if(top_tiles >= slot_count) {
+		throw std::runtime_error("Virtual texture cache cannot hold its coarsest level");
+		return -1;
+	}
+	slot_tiles.assign(slot_count, -1);
+	slot_frames.assign(slot_count, 0);
+	resident.clear();
+
+	// Linear filtering inside a slot never reads past its border
+	unsigned int side = header.tile_size + 2 * header.border;
+	glGenTextures(1, &atlas_id);
+	glBindTexture(GL_TEXTURE_2D, atlas_id);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB8, slots_per_side * side, slots_per_side * side);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glGenTextures(1, &page_table_id);
+	glBindTexture(GL_TEXTURE_2D, page_table_id);
+	glTexStorage2D(GL_TEXTURE_2D, header.level_count, GL_RGBA8, header.tiles_x, header.tiles_y);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// The coarsest level stays resident, every texel falls back to it at worst
+	for(unsigned int y = 0; y < tilesY(top_level); y++)
+		for(unsigned int x = 0; x < tilesX(top_level); x++)
+			uploadTile(Tile{top_level, x, y}, pinned_slots++);
+	updatePageTable();
+
+	return 0;
+}
+
+void VirtualTexture::findTiles(const Tile& tile, const glm::vec3& camera, const glm::mat4& projection, int viewport_height, const Frustum& frustum, std::vector<Tile>& tiles) const {
+	// Texture coordinates covered by the tile, the last ones may stop short of a whole tile
+	float span = (float)(header.tile_size << tile.level);
+	float virtual_width = (float)(header.tiles_x * header.tile_size);
+	float virtual_height = (float)(header.tiles_y * header.tile_size);
+	float u0 = tile.x * span / virtual_width, u1 = std::min((tile.x + 1) * span / virtual_width, 1.0f);
+	float v0 = tile.y * span / virtual_height, v1 = std::min((tile.y + 1) * span / virtual_height, 1.0f);
+
+	// Bounding sphere of the patch from a 3x3 grid of its points, grown by how far the surface bulges between them
+	glm::vec3 points[3][3];
+	glm::vec3 center(0.0f);
+	for(int j = 0; j < 3; j++)
+		for(int i = 0; i < 3; i++) {
+			points[j][i] = spherePoint(u0 + (u1 - u0) * i / 2.0f, v0 + (v1 - v0) * j / 2.0f);
+			center += points[j][i];
+		}
+	float step = std::max((u1 - u0) * pi, (v1 - v0) * pi / 2.0f);
+	float bulge = 1.0f - cosf(std::min(step, pi) / 2.0f);
+	center = (glm::length(center) > 1e-3f) ? glm::normalize(center) : glm::vec3(0.0f);
+	float radius = 0.0f;
+	for(int j = 0; j < 3; j++)
+		for(int i = 0; i < 3; i++)
+			radius = std::max(radius, glm::length(points[j][i] - center));
+	radius += bulge;
+	if(!frustum.intersectsSphere(center, radius))
+		return;
+
+	// Behind the horizon: a unit sphere point faces the camera when its dot product with it exceeds 1,
+	// and between samples that product changes by at most the camera distance times the angle between them
+	float facing = -1e30f;
+	for(int j = 0; j < 3; j++)
+		for(int i = 0; i < 3; i++)
+			facing = std::max(facing, glm::dot(points[j][i], camera));
+	if(facing + glm::length(camera) * step < 1.0f)
+		return;
+
+	tiles.push_back(tile);
+	if(tile.level == 0)
+		return;
+
+	// Refine while a texel of this level covers more than a pixel, in the direction it is smallest on screen
+	// like the mip selection of the shader: at most its shorter side, or its longer side foreshortened
+	float extent_u = glm::length(points[1][1] - points[1][0]) + glm::length(points[1][2] - points[1][1]);
+	float extent_v = glm::length(points[1][1] - points[0][1]) + glm::length(points[2][1] - points[1][1]);
+	float texel_u = extent_u / ((u1 - u0) * virtual_width / (1 << tile.level));
+	float texel_v = extent_v / ((v1 - v0) * virtual_height / (1 << tile.level));
+	float pixels = 0.0f;
+	for(int j = 0; j < 3; j++)
+		for(int i = 0; i < 3; i++) {
+			glm::vec3 to_camera = camera - points[j][i];
+			float distance = std::max(glm::length(to_camera), 1e-4f);
+			float facing_cosine = std::max(glm::dot(points[j][i], to_camera) / distance, 0.0f);
+			float texel = std::min(std::min(texel_u, texel_v), std::max(texel_u, texel_v) * facing_cosine);
+			pixels = std::max(pixels, texel / distance * projection[1][1] * viewport_height / 2.0f);
+		}
+	if(pixels <= 1.0f)
+		return;
+
+	unsigned int level = tile.level - 1;
+	for(unsigned int y = tile.y * 2; y < std::min(tile.y * 2 + 2, tilesY(level)); y++)
+		for(unsigned int x = tile.x * 2; x < std::min(tile.x * 2 + 2, tilesX(level)); x++)
+			findTiles(Tile{level, x, y}, camera, projection, viewport_height, frustum, tiles);
+}
+
+void VirtualTexture::uploadTile(const Tile& tile, unsigned int slot) {
+	size_t index = tileIndex(tile);
+	const unsigned char* pixels = (const unsigned char*)file.data() + sizeof(vtex::Header) + index * tileBytes(header);
+	unsigned int side = header.tile_size + 2 * header.border;
+
+	glBindTexture(GL_TEXTURE_2D, atlas_id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % slots_per_side) * side, (slot / slots_per_side) * side, side, side, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if(slot_tiles[slot] >= 0)
+		resident.erase((size_t)slot_tiles[slot]);
+	slot_tiles[slot] = index;
+	slot_frames[slot] = frame;
+	resident[index] = slot;
+}
+
+void VirtualTexture::updatePageTable() {
+	// Coarsest level first, tiles that are not resident point at the slot of their parent's entry
+	page_table.assign(level_first_tile.back() + (size_t)tilesX(header.level_count - 1) * tilesY(header.level_count - 1), 0);
+	for(unsigned int level = header.level_count; level-- > 0;) {
+		for(unsigned int y = 0; y < tilesY(level); y++)
+			for(unsigned int x = 0; x < tilesX(level); x++) {
+				size_t index = tileIndex(Tile{level, x, y});
+				std::unordered_map<size_t, unsigned int>::const_iterator slot = resident.find(index);
+				if(slot != resident.end())
+					page_table[index] = pageEntry(slot->second % slots_per_side, slot->second / slots_per_side, level);
+				else
+					page_table[index] = page_table[tileIndex(Tile{level + 1, std::min(x / 2, tilesX(level + 1) - 1), std::min(y / 2, tilesY(level + 1) - 1)})];
+			}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, page_table_id);
+	for(unsigned int level = 0; level < header.level_count; level++)
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, tilesX(level), tilesY(level), GL_RGBA, GL_UNSIGNED_BYTE, &page_table[level_first_tile[level]]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VirtualTexture::update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewport_height, FrameStats* stats) {
+	if(!isUploaded())
+		return;
+	frame++;
+
+	// Everything in the space of the unit sphere, the model scale cancels out of the projected sizes
+	Frustum frustum(projection * view * model);
+	glm::vec3 camera = glm::vec3(glm::inverse(view * model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	needed.clear();
+	unsigned int top_level = header.level_count - 1;
+	for(unsigned int y = 0; y < tilesY(top_level); y++)
+		for(unsigned int x = 0; x < tilesX(top_level); x++)
+			findTiles(Tile{top_level, x, y}, camera, projection, viewport_height, frustum, needed);
+
+	// Coarse tiles first, they stand in for the rest until it arrives
+	missing.clear();
+	for(const Tile& tile : needed) {
+		std::unordered_map<size_t, unsigned int>::const_iterator slot = resident.find(tileIndex(tile));
+		if(slot != resident.end())
+			slot_frames[slot->second] = frame;
+		else
+			missing.push_back(tile);
+	}
+	std::stable_sort(missing.begin(), missing.end(), [](const Tile& a, const Tile& b) { return a.level > b.level; });
+
+	unsigned int uploaded = 0;
+	for(const Tile& tile : missing) {
+		if(uploaded >= settings.uploads_per_frame)
+			break;
+		// Least recently needed slot, never one needed this frame
+		unsigned int best = 0;
+		bool found = false;
+		for(unsigned int slot = pinned_slots; slot < slot_tiles.size(); slot++) {
+			if((slot_tiles[slot] >= 0) && (slot_frames[slot] == frame))
+				continue;
+			if(!found || (slot_tiles[slot] < 0) || ((slot_tiles[best] >= 0) && (slot_frames[slot] < slot_frames[best]))) {
+				best = slot;
+				found = true;
+				if(slot_tiles[slot] < 0)
+					break;
+			}
+		}
+		if(!found)
+			break;
+		uploadTile(tile, best);
+		uploaded++;
+	}
+	if(uploaded > 0)
+		updatePageTable();
+
+	if(stats) {
+		stats->tiles_needed += needed.size();
+		stats->tiles_missing += missing.size() - uploaded;
+		stats->tiles_uploaded += uploaded;
+	}
+}
+
+void VirtualTexture::bind(const UniformLocations& uniforms, unsigned int atlas_unit, unsigned int page_table_unit) const {
+	glActiveTexture(GL_TEXTURE0 + atlas_unit);
+	glBindTexture(GL_TEXTURE_2D, atlas_id);
+	glActiveTexture(GL_TEXTURE0 + page_table_unit);
+	glBindTexture(GL_TEXTURE_2D, page_table_id);
+
+	unsigned int side = header.tile_size + 2 * header.border;
+	glUniform2f(uniforms.virtual_size, (float)(header.tiles_x * header.tile_size), (float)(header.tiles_y * header.tile_size));
+	glUniform1f(uniforms.tile_size, (float)header.tile_size);
+	glUniform1f(uniforms.tile_border, (float)header.border);
+	glUniform1f(uniforms.atlas_size, (float)(slots_per_side * side));
+	glUniform1i(uniforms.max_level, header.level_count - 1);
+}
+
+VirtualTexture::~VirtualTexture() {
+	if(atlas_id)
+		glDeleteTextures(1, &atlas_id);
+	if(page_table_id)
+		glDeleteTextures(1, &page_table_id);
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <string>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mappedFile.hpp"
+#include "frameStats.hpp"
+#include "uniforms.hpp"
+
+class Frustum;
+
+struct VirtualTextureSettings {
+	// Texels on each side of a tile, without its border
+	unsigned int tile_size = 128;
+	// Tiles resident at once, rounded up to a square atlas
+	unsigned int cache_tiles = 256;
+	// Tiles read and uploaded at most each frame
+	unsigned int uploads_per_frame = 16;
+};
+
+// Tiled mip pyramid of a large equirectangular image, stored next to it with the .vtex extension
+// Layout: Header, then the tiles of every level from the finest, rows of tiles bottom to top,
+// each tile (tile_size + 2 * border)^2 RGB texels with a border repeating its neighbours
+namespace vtex {
+	const char magic[4] = {'B', 'V', 'T', 'X'};
+	const uint32_t version = 1;
+	const uint32_t border = 1;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t source_size;
+		int64_t source_mtime;
+		uint64_t source_hash;
+		// Power of two number of tiles of the finest level, the image is resampled to fill them
+		uint32_t tiles_x;
+		uint32_t tiles_y;
+		uint32_t tile_size;
+		uint32_t border;
+		uint32_t level_count;
+		uint32_t padding;
+	};
+
+	// earth.jpg -> earth.jpg.vtex
+	std::string cachePath(std::string image_file_path);
+
+	// Map the tiles of an image, false if missing, corrupt, older than the source or of another tile size
+	bool open(std::string image_file_path, MappedFile& cache_file, unsigned int tile_size);
+
+	// Decode an image and write its tiles, false if the directory is not writable
+	bool write(std::string image_file_path, unsigned int tile_size);
+}
+
+// Virtual texture of a sphere mapped like the procedural spheres, only the tiles in view are resident
+// Each frame the tiles needed are found on the CPU from the sphere patches they cover, the missing
+// ones are uploaded to an atlas in place of the least recently needed, and a page table texture
+// gives the shader the atlas slot of the finest resident tile at every level
+class VirtualTexture {
+private:
+	MappedFile file;
+	vtex::Header header;
+	VirtualTextureSettings settings;
+	std::vector<size_t> level_first_tile;
+
+	unsigned int atlas_id = 0;
+	unsigned int page_table_id = 0;
+	unsigned int slots_per_side = 0;
+
+	// Tile held by each atlas slot (-1 when free) and the last frame it was needed
+	std::vector<int64_t> slot_tiles;
+	std::vector<uint64_t> slot_frames;
+	std::unordered_map<size_t, unsigned int> resident;
+	unsigned int pinned_slots = 0;
+	uint64_t frame = 0;
+
+	// Packed RGBA8 entries of every level, indexed like the tiles: atlas slot x, y and the level of the tile
+	std::vector<uint32_t> page_table;
+
+	struct Tile {
+		unsigned int level;
+		unsigned int x;
+		unsigned int y;
+	};
+
+	// Tiles of the last update, kept to reuse their storage
+	std::vector<Tile> needed;
+	std::vector<Tile> missing;
+
+	unsigned int tilesX(unsigned int level) const { return std::max(header.tiles_x >> level, 1u); }
+	unsigned int tilesY(unsigned int level) const { return std::max(header.tiles_y >> level, 1u); }
+	size_t tileIndex(const Tile& tile) const { return level_first_tile[tile.level] + (size_t)tile.y * tilesX(tile.level) + tile.x; }
+
+	void findTiles(const Tile& tile, const glm::vec3& camera, const glm::mat4& projection, int viewport_height, const Frustum& frustum, std::vector<Tile>& tiles) const;
+	void uploadTile(const Tile& tile, unsigned int slot);
+	void updatePageTable();
+
+public:
+	VirtualTexture() = default;
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	// Map the tiles of an image, building them first when missing or outdated
+	// Does not touch OpenGL, safe to call from worker threads
+	unsigned char open(std::string image_file_path, const VirtualTextureSettings& settings);
+
+	// Create the atlas and page table, with the coarsest level resident for good
+	unsigned char create();
+
+	bool isUploaded() const { return atlas_id != 0; }
+	unsigned int getAtlasId() const { return atlas_id; }
+
+	// Make the tiles seen through the matrices resident, within the per frame upload limit
+	void update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewport_height, FrameStats* stats = nullptr);
+
+	// Bind the atlas and page table to the texture units the program samples them from and set the sampling uniforms
+	void bind(const UniformLocations& uniforms, unsigned int atlas_unit, unsigned int page_table_unit) const;
+
+	~VirtualTexture();
+};
@@ -0,0 +1,218 @@
+// Obj loading micro benchmark
+// Compares the original getline/stringstream/stof loop against obj::load on the given files,
+// then the scaling of the chunked parser at 1/2/4/8 threads
+// Built with assimp, each obj is also imported by assimp and converted to a binary glTF copy to time the .glb path
+// Other files (.glb, .gltf, .fbx, ...) are only timed through the importer
+// Usage: objBench [iterations] file.obj [file.glb ...]
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../src/objParser.hpp"
+#include "../src/meshImporter.hpp"
+
+#ifdef BERGIMUS_ASSIMP
+#include <assimp/Exporter.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#endif
+
+namespace {
+	// Reference copy of the loader previously found in Object::createBuffer
+	void legacyLoad(std::string obj_file, MeshData& mesh) {
+		std::ifstream obj_stream;
+		obj_stream.open(obj_file);
+		if(!obj_stream.good())
+			throw std::runtime_error(std::string("Failed to open obj file: ")+obj_file);
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texture;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec3> face;
+
+		std::string line;
+		unsigned char i = 0;
+		while(!obj_stream.eof()) {
+			std::getline(obj_stream, line);
+			std::stringstream lineStream(line);
+
+			std::getline(lineStream, line, ' ');
+			if(line.compare("v") == 0) {
+				i = 0;
+				glm::vec3 temp_pos;
+				while(std::getline(lineStream, line, ' ')) {
+					temp_pos[i] = std::stof(line);
+					i++;
+				}
+				positions.push_back(temp_pos);
+			}
+			else if(line.compare("vt") == 0) {
+				i = 0;
+				glm::vec2 temp_pos;
+				while(std::getline(lineStream, line, ' ')) {
+					temp_pos[i] = std::stof(line);
+					i++;
+				}
+				texture.push_back(temp_pos);
+			}
+			else if(line.compare("vn") == 0) {
+				i = 0;
+				glm::vec3 temp_pos;
+				while(std::getline(lineStream, line, ' ')) {
+					temp_pos[i] = std::stof(line);
+					i++;
+				}
+				normals.push_back(temp_pos);
+			}
+			else if(line.compare("f") == 0) {
+				while(std::getline(lineStream, line, ' ')) {
+					i = 0;
+					glm::vec3 temp_pos;
+					std::stringstream subLineStream(line);
+					while(std::getline(subLineStream, line, '/')) {
+						temp_pos[i] = std::stof(line);
+						i++;
+					}
+					face.push_back(temp_pos);
+				}
+			}
+		}
+
+		for(unsigned int i = 0; i < face.size(); i++) {
+			Vertex temp_vertex;
+			temp_vertex.position = positions[face[i].x-1];
+			temp_vertex.texture = texture[face[i].y-1];
+			temp_vertex.normal = normals[face[i].z-1];
+			mesh.vertices.push_back(temp_vertex);
+		}
+		for(unsigned int i = 0; i < mesh.vertices.size(); i++) {
+			mesh.indices.push_back(i);
+		}
+	}
+
+	template<typename F>
+	double measure(unsigned int iterations, F load) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for(unsigned int i = 0; i < iterations; i++)
+			load();
+		std::chrono::duration<double> span = std::chrono::high_resolution_clock::now() - start;
+		return span.count() / iterations;
+	}
+
+	// Compare corner by corner, the legacy loader stores one vertex per corner
+	bool identicalMesh(const MeshData& a, const MeshData& b) {
+		return (a.vertices.size() == b.vertices.size()) && (a.indices == b.indices) &&
+			(memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0);
+	}
+
+#ifdef BERGIMUS_ASSIMP
+	// Binary glTF copy of an obj, to time both formats on the same model
+	bool exportGlb(std::string obj_file, std::string glb_file) {
+		Assimp::Importer scene_importer;
+		const aiScene* scene = scene_importer.ReadFile(obj_file, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+		if(!scene)
+			return false;
+		Assimp::Exporter scene_exporter;
+		return scene_exporter.Export(scene, "glb2", glb_file) == aiReturn_SUCCESS;
+	}
+#endif
+
+	bool sameMesh(const MeshData& legacy, const MeshData& mesh) {
+		if(legacy.indices.size() != mesh.indices.size())
+			return false;
+		for(size_t i = 0; i < mesh.indices.size(); i++) {
+			if(memcmp(&legacy.vertices[legacy.indices[i]], &mesh.vertices[mesh.indices[i]], sizeof(Vertex)) != 0)
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	if(argc < 2) {
+		std::cout << "Usage: " << argv[0] << " [iterations] file.obj [file.obj ...]" << std::endl;
+		return 1;
+	}
+
+	int first_file = 1;
+	unsigned int iterations = 10;
+	if(strtol(argv[1], nullptr, 10) > 0) {
+		iterations = strtol(argv[1], nullptr, 10);
+		first_file = 2;
+	}
+
+	const unsigned int thread_counts[] = {1, 2, 4, 8};
+	ThreadPool pool(7);
+
+	for(int i = first_file; i < argc; i++) {
+		struct stat file_stat;
+		if(stat(argv[i], &file_stat) != 0) {
+			std::cout << argv[i] << ": not found" << std::endl;
+			continue;
+		}
+		double megabytes = file_stat.st_size / (1024.0 * 1024.0);
+		if(importer::handles(argv[i])) {
+			if(!importer::available()) {
+				std::cout << argv[i] << ": built without assimp" << std::endl;
+				continue;
+			}
+			MeshData imported_mesh;
+			importer::load(argv[i], imported_mesh);
+			double imported_time = measure(iterations, [&]() { MeshData mesh; importer::load(argv[i], mesh); });
+			std::cout << argv[i] << " (" << file_stat.st_size << " bytes)" << std::endl;
+			std::cout << "\tassimp: " << imported_time * 1000.0 << " ms, " << megabytes / imported_time << " MB/s, "
+				<< imported_mesh.indices.size() / 3 << " triangles" << std::endl;
+			continue;
+		}
+
+		MeshData legacy_mesh, mapped_mesh;
+		legacyLoad(argv[i], legacy_mesh);
+		obj::load(argv[i], mapped_mesh);
+
+		double legacy_time = measure(iterations, [&]() { MeshData mesh; legacyLoad(argv[i], mesh); });
+		double mapped_time = measure(iterations, [&]() { MeshData mesh; obj::load(argv[i], mesh); });
+
+		std::cout << argv[i] << " (" << file_stat.st_size << " bytes)" << std::endl;
+		std::cout << "\tgetline/stof: " << legacy_time * 1000.0 << " ms, " << megabytes / legacy_time << " MB/s" << std::endl;
+		std::cout << "\tmmap parser:  " << mapped_time * 1000.0 << " ms, " << megabytes / mapped_time << " MB/s" << std::endl;
+		std::cout << "\tspeedup: " << legacy_time / mapped_time << "x, output " << (sameMesh(legacy_mesh, mapped_mesh) ? "identical" : "DIFFERS") << std::endl;
+
+		for(unsigned int threads : thread_counts) {
+			MeshData chunked_mesh;
+			obj::load(argv[i], chunked_mesh, &pool, threads);
+			double chunked_time = measure(iterations, [&]() { MeshData mesh; obj::load(argv[i], mesh, &pool, threads); });
+			std::cout << "\t" << threads << " threads: " << chunked_time * 1000.0 << " ms, " << megabytes / chunked_time << " MB/s, "
+				<< mapped_time / chunked_time << "x, output " << (identicalMesh(mapped_mesh, chunked_mesh) ? "identical" : "DIFFERS") << std::endl;
+		}
+#ifdef BERGIMUS_ASSIMP
+		double assimp_obj_time = measure(iterations, [&]() { MeshData mesh; importer::load(argv[i], mesh); });
+		std::cout << "\tassimp obj:   " << assimp_obj_time * 1000.0 << " ms, " << megabytes / assimp_obj_time << " MB/s, "
+			<< assimp_obj_time / mapped_time << "x the mmap parser time" << std::endl;
+		std::string glb_file = std::string(argv[i]) + ".bench.glb";
+		struct stat glb_stat;
+		if(exportGlb(argv[i], glb_file) && (stat(glb_file.c_str(), &glb_stat) == 0)) {
+			MeshData glb_mesh;
+			importer::load(glb_file, glb_mesh);
+			double glb_time = measure(iterations, [&]() { MeshData mesh; importer::load(glb_file, mesh); });
+			std::cout << "\tassimp glb:   " << glb_time * 1000.0 << " ms (" << glb_stat.st_size << " bytes), "
+				<< glb_time / mapped_time << "x the mmap parser time, " << glb_mesh.indices.size() / 3 << " triangles against "
+				<< mapped_mesh.indices.size() / 3 << std::endl;
+		}
+		else
+			std::cout << "\tassimp glb:   export failed" << std::endl;
+		remove(glb_file.c_str());
+#endif
+	}
+
+	return 0;
+}
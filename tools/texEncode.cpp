@@ -0,0 +1,153 @@
+// Offline block compression of jpg/png textures
+// Writes a dds file with the full mip chain next to the image (earth.jpg -> earth.dds), BC1 for RGB
+// images and BC3 when there is an alpha channel, rows bottom to top as Bergimus uploads them
+// Usage: texEncode [--bc1|--bc3] image.jpg [output.dds] [image.png ...]
+
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/blockTexture.hpp"
+#include "../src/threadPool.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+	// Half size copy, averaging 2x2 pixels (the last row or column alone on odd sizes)
+	void downsample(const std::vector<unsigned char>& pixels, int width, int height, int channels, std::vector<unsigned char>& half) {
+		int half_width = std::max(width / 2, 1);
+		int half_height = std::max(height / 2, 1);
+		half.resize((size_t)half_width * half_height * channels);
+		for(int y = 0; y < half_height; y++)
+			for(int x = 0; x < half_width; x++)
+				for(int c = 0; c < channels; c++) {
+					int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+					int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+					int sum = pixels[((size_t)y0 * width + x0) * channels + c] + pixels[((size_t)y0 * width + x1) * channels + c]
+						+ pixels[((size_t)y1 * width + x0) * channels + c] + pixels[((size_t)y1 * width + x1) * channels + c];
+					half[((size_t)y * half_width + x) * channels + c] = (sum + 2) / 4;
+				}
+	}
+
+	// Peak signal to noise ratio of the color channels of the first level
+	float colorPsnr(const std::vector<unsigned char>& pixels, int width, int height, int channels, const std::vector<unsigned char>& blocks, bc::Format format) {
+		std::vector<unsigned char> decoded((size_t)width * height * 4);
+		bc::decode(blocks.data(), width, height, format, decoded.data());
+		double error = 0.0;
+		for(size_t i = 0; i < (size_t)width * height; i++)
+			for(int c = 0; c < 3; c++) {
+				double d = (double)pixels[i * channels + c] - decoded[i * 4 + c];
+				error += d * d;
+			}
+		error /= (double)width * height * 3;
+		return (error > 0.0) ? 10.0 * log10(255.0 * 255.0 / error) : 99.0f;
+	}
+
+	std::string ddsPath(std::string image_file_path) {
+		size_t dot = image_file_path.find_last_of('.');
+		size_t slash = image_file_path.find_last_of('/');
+		if((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash)))
+			return image_file_path + ".dds";
+		return image_file_path.substr(0, dot) + ".dds";
+	}
+
+	void encodeFile(std::string image_file_path, std::string dds_file_path, bc::Format forced_format, ThreadPool& pool) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		int width, height, file_channels;
+		if(!stbi_info(image_file_path.c_str(), &width, &height, &file_channels))
+			throw std::runtime_error(std::string("Failed to load texture image: ")+image_file_path);
+		int channels = ((file_channels == 2) || (file_channels == 4)) ? 4 : 3;
+		unsigned char* loaded = stbi_load(image_file_path.c_str(), &width, &height, &file_channels, channels);
+		if(!loaded)
+			throw std::runtime_error(std::string("Failed to load texture image: ")+image_file_path);
+		std::vector<unsigned char> pixels(loaded, loaded + (size_t)width * height * channels);
+		stbi_image_free(loaded);
+		bc::Format format = (forced_format != bc::NONE) ? forced_format : ((channels == 4) ? bc::BC3 : bc::BC1);
+
+		// Every level down to 1x1, encoded a row of blocks per job
+		std::vector<unsigned char> blocks;
+		std::vector<bc::Level> levels;
+		std::vector<unsigned char> level_pixels = pixels;
+		float psnr = 0.0f;
+		for(int level_width = width, level_height = height;; ) {
+			bc::Level level;
+			level.width = level_width;
+			level.height = level_height;
+			level.offset = blocks.size();
+			level.size = bc::levelSize(format, level_width, level_height);
+			levels.push_back(level);
+			blocks.resize(blocks.size() + level.size);
+
+			size_t block_rows = (level_height + 3) / 4;
+			size_t row_bytes = bc::levelSize(format, level_width, 4);
+			pool.parallelFor(block_rows, [&](size_t row) {
+				int row_height = std::min(4, level_height - (int)row * 4);
+				bc::encode(&level_pixels[row * 4 * level_width * channels], level_width, row_height, channels, format, &blocks[level.offset + row * row_bytes]);
+			});
+			if(levels.size() == 1)
+				psnr = colorPsnr(level_pixels, level_width, level_height, channels, blocks, format);
+
+			if((level_width == 1) && (level_height == 1))
+				break;
+			std::vector<unsigned char> half;
+			downsample(level_pixels, level_width, level_height, channels, half);
+			level_pixels.swap(half);
+			level_width = std::max(level_width / 2, 1);
+			level_height = std::max(level_height / 2, 1);
+		}
+		bc::writeDds(dds_file_path, format, blocks, levels);
+
+		std::chrono::duration<float, std::milli> span = std::chrono::high_resolution_clock::now() - start;
+		float raw_mb = (float)width * height * channels * 4 / 3 / (1024.0f * 1024.0f);
+		float block_mb = blocks.size() / (1024.0f * 1024.0f);
+		std::cout << image_file_path << " -> " << dds_file_path << ": " << width << "x" << height << " " << ((format == bc::BC3) ? "BC3" : "BC1")
+			<< ", " << levels.size() << " levels, " << raw_mb << " MB -> " << block_mb << " MB (" << raw_mb / block_mb << "x), PSNR "
+			<< psnr << " dB, " << span.count() << " ms" << std::endl;
+	}
+
+	bool isDdsPath(const std::string& file_path) {
+		return (file_path.size() > 4) && (file_path.compare(file_path.size() - 4, 4, ".dds") == 0);
+	}
+}
+
+int main(int argc, char** argv) {
+	bc::Format forced_format = bc::NONE;
+	std::vector<std::string> arguments;
+	for(int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if(argument == "--bc1")
+			forced_format = bc::BC1;
+		else if(argument == "--bc3")
+			forced_format = bc::BC3;
+		else
+			arguments.push_back(argument);
+	}
+	if(arguments.empty()) {
+		std::cout << "Usage: texEncode [--bc1|--bc3] image.jpg [output.dds] [image.png ...]" << std::endl;
+		return 1;
+	}
+
+	// Same orientation as the textures decoded at run time
+	stbi_set_flip_vertically_on_load(true);
+	ThreadPool pool;
+	try {
+		for(size_t i = 0; i < arguments.size(); i++) {
+			std::string image_file_path = arguments[i];
+			std::string dds_file_path = ddsPath(image_file_path);
+			if((i + 1 < arguments.size()) && isDdsPath(arguments[i + 1]))
+				dds_file_path = arguments[++i];
+			encodeFile(image_file_path, dds_file_path, forced_format, pool);
+		}
+	}
+	catch(const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}